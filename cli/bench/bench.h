@@ -0,0 +1,50 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace NCli {
+namespace NBench {
+
+/**
+ * Registers a benchmark to be run by `cli_bench`. This is not supposed to be called directly, use
+ * {@link CLI_BENCHMARK} instead.
+ */
+bool RegisterBenchmark(const std::string& name, void (*body)());
+
+/**
+ * Runs {@arg body} {@arg iterations} times and prints the mean time of a single iteration under the name {@arg name}.
+ *
+ * When {@arg bytes} is not zero, it is the amount of data processed by a single iteration, and the throughput is
+ * printed as well.
+ */
+void Measure(const std::string& name, std::size_t iterations, const std::function<void()>& body,
+             std::size_t bytes = 0);
+
+} // namespace NBench
+} // namespace NCli
+
+/**
+ * Defines a benchmark. The body is a function which calls {@link NCli::NBench::Measure} for every measured case.
+ */
+#define CLI_BENCHMARK(name) \
+    static void name(); \
+    static const bool name##Registered = ::NCli::NBench::RegisterBenchmark(#name, &name); \
+    static void name()
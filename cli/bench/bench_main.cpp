@@ -0,0 +1,74 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace NCli {
+namespace NBench {
+namespace {
+
+std::vector<std::pair<std::string, void (*)()>>& Benchmarks() {
+    static std::vector<std::pair<std::string, void (*)()>> benchmarks;
+    return benchmarks;
+}
+
+} // namespace <anonymous>
+
+bool RegisterBenchmark(const std::string& name, void (*body)()) {
+    Benchmarks().emplace_back(name, body);
+    return true;
+}
+
+void Measure(const std::string& name, std::size_t iterations, const std::function<void()>& body, std::size_t bytes) {
+    body();
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i != iterations; i++) {
+        body();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double perIteration = elapsed.count() / iterations;
+    std::printf("  %-56s %12.2f us/op", name.c_str(), perIteration * 1e6);
+    if (bytes != 0) {
+        std::printf(" %10.1f MB/s", bytes / perIteration / 1e6);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+} // namespace NBench
+} // namespace NCli
+
+/**
+ * Runs every registered benchmark, or only those whose names contain the first argument.
+ */
+int main(int argc, char* argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    for (const auto& [name, body] : NCli::NBench::Benchmarks()) {
+        if (name.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::printf("%s\n", name.c_str());
+        body();
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <environment/environment.h>
+#include <environment/var_expander.h>
+#include <tokenizer/tokenizer.h>
+
+#include <string>
+#include <vector>
+
+using namespace NCli;
+using namespace NCli::NBench;
+
+namespace {
+
+TEnvironment MakeEnvironment(std::size_t variables) {
+    TEnvironment env;
+    for (std::size_t i = 0; i != variables; i++) {
+        env["VARIABLE_" + std::to_string(i)] = "/some/value/of/a/typical/length/" + std::to_string(i);
+    }
+    return env;
+}
+
+} // namespace <anonymous>
+
+CLI_BENCHMARK(CommandEnvironmentImage) {
+    TEnvironment env = MakeEnvironment(500);
+
+    Measure("500 variables, 1 override: ToEnvP", 2000, [&]() {
+        TCmdEnvironment cmdEnv(env);
+        cmdEnv.SetLocalValue("VARIABLE_7", "override");
+        auto envp = cmdEnv.ToEnvP();
+    });
+    Measure("500 variables, 1 override: EnvP", 2000, [&]() {
+        TCmdEnvironment cmdEnv(env);
+        cmdEnv.SetLocalValue("VARIABLE_7", "override");
+        auto envp = cmdEnv.EnvP();
+    });
+    Measure("500 variables, 1 assignment, then EnvP", 2000, [&]() {
+        env["VARIABLE_7"] = "assigned";
+        TCmdEnvironment cmdEnv(env);
+        auto envp = cmdEnv.EnvP();
+    });
+}
+
+CLI_BENCHMARK(EnvironmentSnapshot) {
+    TEnvironment env = MakeEnvironment(1000);
+
+    Measure("1000 variables: snapshot", 20000, [&]() {
+        TEnvironment snapshot = env;
+    });
+    Measure("1000 variables: snapshot, 1 local assignment, lookup", 20000, [&]() {
+        TEnvironment snapshot = env;
+        TCmdEnvironment cmdEnv(snapshot);
+        cmdEnv.SetLocalValue("VARIABLE_7", "override");
+        cmdEnv.GetValue("VARIABLE_500");
+    });
+}
+
+CLI_BENCHMARK(ExpandVariables) {
+    TEnvironment env = MakeEnvironment(1000);
+    TVarExpander expander(env);
+
+    std::string line = "echo";
+    for (std::size_t i = 0; i != 50; i++) {
+        line += " $VARIABLE_" + std::to_string(i * 19) + "/suffix:$VARIABLE_" + std::to_string(i * 7) + "$MISSING";
+    }
+    line += "\n";
+    TTokenizer tokenizer;
+    tokenizer.Update(line);
+    const std::vector<TToken>& tokens = tokenizer.ParsedTokens();
+
+    Measure("expand a line with 150 references, 1000 variables", 20000, [&]() {
+        expander.Expand(std::vector<TToken>(tokens));
+    });
+}
+
+CLI_BENCHMARK(ExpandScript) {
+    TEnvironment env = MakeEnvironment(100);
+    env["HOME"] = "/home/user";
+    env["PATH"] = "/usr/local/bin:/usr/bin:/bin";
+    TVarExpander expander(env);
+
+    // A loop body of a few lines, unrolled 10000 times, as a sourced script or a history replay would run it.
+    const std::vector<std::string> body = {
+        "cat $HOME/logs/$VARIABLE_1.log | grep -e \"$VARIABLE_2\" | wc -l\n",
+        "echo \"$VARIABLE_3: $VARIABLE_4/$VARIABLE_5\" $HOME\n",
+        "PATH=$PATH:$HOME/bin ls -la $VARIABLE_6 '$literal'\n",
+    };
+    std::vector<std::vector<TToken>> lines;
+    for (const std::string& line : body) {
+        TTokenizer tokenizer;
+        tokenizer.Update(line);
+        lines.push_back(tokenizer.TakeTokens());
+    }
+
+    Measure("10000 iterations of a 3-line script, per line", 30000, [&, i = std::size_t(0)]() mutable {
+        expander.Expand(std::vector<TToken>(lines[i++ % lines.size()]));
+    });
+}
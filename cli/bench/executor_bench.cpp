@@ -0,0 +1,281 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <common/fd_stream.h>
+#include <executor/execute.h>
+#include <executor/executor.h>
+#include <executor/private/builtin_executors.h>
+#include <executor/private/command_hash.h>
+#include <executor/private/external_executor.h>
+#include <tokenizer/tokenizer.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace NCli;
+using namespace NCli::NBench;
+
+namespace {
+
+TCommand MakeCommand(const std::string& cmdline) {
+    TTokenizer tokenizer;
+    tokenizer.Update(cmdline);
+    return Parse(tokenizer.ParsedTokens())[0];
+}
+
+void MeasureExecutor(const std::string& name, IExecutor& executor, const TCommand& command, const std::string& input) {
+    Measure(name, 2000, [&]() {
+        std::istringstream is(input);
+        TPipeIStreamWrapper isw(is);
+        std::ostringstream os;
+        executor.Execute(command, isw, os);
+    });
+}
+
+template <typename TExecutor>
+void CompareModes(const std::string& cmdline, const std::string& input) {
+    TEnvironment env;
+    TCommand command = MakeCommand(cmdline + "\n");
+
+    auto inProcess = std::make_shared<TExecutor>(env);
+    NPrivate::TForkedExecutor forked(inProcess, env);
+
+    MeasureExecutor(cmdline + " (in-process)", *inProcess, command, input);
+    MeasureExecutor(cmdline + " (fork)", forked, command, input);
+}
+
+void CompareSpawnMethods(const std::string& heapDescription) {
+    TEnvironment env;
+    env["PATH"] = std::getenv("PATH");
+    TCommand command = MakeCommand("true\n");
+    NPrivate::TExternalExecutor executor(env);
+
+    MeasureExecutor("true, posix_spawn, " + heapDescription, executor, command, "");
+    env["CLI_SPAWN_METHOD"] = "fork";
+    MeasureExecutor("true, fork, " + heapDescription, executor, command, "");
+}
+
+/**
+ * Returns the number of write system calls made by the process so far.
+ */
+std::size_t WriteSyscalls() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    std::size_t value = 0;
+    while (io >> key >> value) {
+        if (key == "syscw:") {
+            return value;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Returns the user and the system CPU time of the calling thread in microseconds.
+ */
+std::pair<long, long> ThreadCpuTime() {
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return {usage.ru_utime.tv_sec * 1000000L + usage.ru_utime.tv_usec,
+            usage.ru_stime.tv_sec * 1000000L + usage.ru_stime.tv_usec};
+}
+
+/**
+ * Returns the number of context switches of the process and its waited children so far.
+ */
+long ContextSwitches() {
+    long switches = 0;
+    for (int who : {RUSAGE_SELF, RUSAGE_CHILDREN}) {
+        rusage usage;
+        getrusage(who, &usage);
+        switches += usage.ru_nvcsw + usage.ru_nivcsw;
+    }
+    return switches;
+}
+
+} // namespace <anonymous>
+
+CLI_BENCHMARK(BuiltinOutput) {
+    std::string input;
+    for (std::size_t i = 0; i != 1000000; i++) {
+        input += "matching line number " + std::to_string(i) + "\n";
+    }
+    TEnvironment env;
+    NPrivate::TGrepExecutor grep(env);
+    TCommand command = MakeCommand("grep matching\n");
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    std::size_t writes = WriteSyscalls();
+    Measure("grep, 1000000 matching lines to a descriptor", 1, [&]() {
+        std::istringstream is(input);
+        TPipeIStreamWrapper isw(is);
+        TFdOStream os(devNull);
+        grep.Execute(command, isw, os);
+    }, input.size());
+    std::cout << "  write(2) calls: " << WriteSyscalls() - writes << std::endl;
+
+    close(devNull);
+}
+
+CLI_BENCHMARK(BuiltinInvocationLatency) {
+    std::string input = "some\nshort input\nfor the built-ins\n";
+
+    CompareModes<NPrivate::TWcExecutor>("wc", input);
+    CompareModes<NPrivate::TGrepExecutor>("grep input", input);
+    CompareModes<NPrivate::TCatExecutor>("cat", input);
+}
+
+CLI_BENCHMARK(ExternalSpawnLatency) {
+    CompareSpawnMethods("small heap");
+
+    // fork has to copy the page tables of the whole heap, posix_spawn does not.
+    const std::size_t heapSize = std::size_t(512) << 20;
+    std::unique_ptr<char[]> heap(new char[heapSize]);
+    std::memset(heap.get(), 1, heapSize);
+    CompareSpawnMethods("512 MiB heap");
+}
+
+CLI_BENCHMARK(CommandLookup) {
+    std::string path = std::getenv("PATH");
+    NPrivate::TCommandHashTable table;
+
+    Measure("lookup of true in $PATH (search)", 20000, [&]() {
+        table.Clear();
+        table.Find(path, "true");
+    });
+    Measure("lookup of true in $PATH (hashed)", 20000, [&]() {
+        table.Find(path, "true");
+    });
+}
+
+CLI_BENCHMARK(CatFile) {
+    // CLI_BENCH_CAT_MB sets the size of the file in MiB, 1024 by default.
+    const char* megabytes = std::getenv("CLI_BENCH_CAT_MB");
+    const std::size_t bytes = (megabytes != nullptr ? std::strtoul(megabytes, nullptr, 10) : 1024) << 20;
+    char filename[] = "/tmp/cli_bench_cat_XXXXXX";
+    char copyname[] = "/tmp/cli_bench_cat_XXXXXX";
+    close(mkstemp(filename));
+    close(mkstemp(copyname));
+    {
+        std::ofstream out(filename);
+        const std::string chunk(16 << 20, 'x');
+        for (std::size_t written = 0; written < bytes; written += chunk.size()) {
+            out << chunk;
+        }
+    }
+
+    TEnvironment env;
+    NPrivate::TCatExecutor cat(env);
+    TCommand command = MakeCommand(std::string("cat ") + filename + "\n");
+    const std::string size = std::to_string(bytes >> 20) + " MiB";
+
+    auto measure = [&](const std::string& name, const std::function<void(std::ostream&)>& body, int fd) {
+        auto start = ThreadCpuTime();
+        Measure(name, 1, [&]() {
+            TFdOStream os(fd);
+            body(os);
+        }, bytes);
+        auto end = ThreadCpuTime();
+        std::cout << "  cat thread CPU: user " << (end.first - start.first) / 1000 << " ms, system "
+                  << (end.second - start.second) / 1000 << " ms" << std::endl;
+    };
+    auto execute = [&](std::ostream& os) {
+        std::istringstream is;
+        TPipeIStreamWrapper isw(is);
+        cat.Execute(command, isw, os);
+    };
+
+    int fds[2];
+    if (pipe(fds) == 0) {
+        std::thread reader([&]() {
+            std::unique_ptr<char[]> buffer(new char[1 << 16]);
+            while (ReadSome(fds[0], buffer.get(), 1 << 16) > 0) {
+            }
+        });
+        measure("cat, " + size + " file into a pipe", execute, fds[1]);
+        measure("cat, " + size + " file into a pipe through a stream buffer", [&](std::ostream& os) {
+            // A plain std::ostream hides the descriptor, so the data is copied through the user space.
+            std::ostream plain(os.rdbuf());
+            execute(plain);
+        }, fds[1]);
+        close(fds[1]);
+        reader.join();
+        close(fds[0]);
+    }
+
+    int copy = open(copyname, O_WRONLY | O_TRUNC | O_CLOEXEC);
+    measure("cat, " + size + " file into a file", execute, copy);
+    close(copy);
+
+    unlink(filename);
+    unlink(copyname);
+}
+
+CLI_BENCHMARK(PipelineThroughput) {
+    // CLI_BENCH_CAT_MB sets the size of the file in MiB, 256 by default.
+    const char* megabytes = std::getenv("CLI_BENCH_CAT_MB");
+    const std::size_t bytes = (megabytes != nullptr ? std::strtoul(megabytes, nullptr, 10) : 256) << 20;
+    char filename[] = "/tmp/cli_bench_pipeline_XXXXXX";
+    close(mkstemp(filename));
+    {
+        std::ofstream out(filename);
+        std::string chunk;
+        for (std::size_t i = 0; chunk.size() < (16 << 20); i++) {
+            chunk += "line number " + std::to_string(i) + " of the pipeline input\n";
+        }
+        for (std::size_t written = 0; written < bytes; written += chunk.size()) {
+            out << chunk;
+        }
+    }
+    const std::string file = filename;
+    const std::string size = std::to_string(bytes >> 20) + " MiB";
+
+    TEnvironment env;
+    env["PATH"] = std::getenv("PATH");
+    for (const std::string& pipeline : {"cat " + file + " | cat - | cat - | wc",
+                                        "cat " + file + " | tr a X | wc",
+                                        "cat " + file + " | tr a X | tr X a | wc -l"}) {
+        TTokenizer tokenizer;
+        tokenizer.Update(pipeline + "\n");
+        TFullCommand command = Parse(tokenizer.ParsedTokens());
+        const std::string name = pipeline.substr(0, 4) + size + pipeline.substr(4 + file.size());
+        for (const char* pipeSize : {"65536", "262144", "1048576"}) {
+            env["CLI_PIPE_SIZE"] = pipeSize;
+            long switches = ContextSwitches();
+            Measure(name + ", CLI_PIPE_SIZE=" + pipeSize, 1, [&]() {
+                std::istringstream is;
+                TPipeIStreamWrapper isw(is);
+                std::ostringstream os;
+                Execute(command, env, isw, os);
+            }, bytes);
+            std::cout << "  context switches: " << ContextSwitches() - switches << std::endl;
+        }
+    }
+
+    unlink(filename);
+}
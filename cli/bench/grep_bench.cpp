@@ -0,0 +1,239 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <common/fd_stream.h>
+#include <common/parallel.h>
+#include <executor/executor.h>
+#include <executor/private/builtin_executors.h>
+#include <executor/private/grep_matcher.h>
+#include <tokenizer/tokenizer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace NCli;
+using namespace NCli::NBench;
+
+namespace {
+
+/**
+ * Returns the size of the log file in MiB: 1024 unless set by CLI_BENCH_GREP_MB.
+ */
+std::size_t LogMegabytes() {
+    const char* value = std::getenv("CLI_BENCH_GREP_MB");
+    return value != nullptr ? std::strtoul(value, nullptr, 10) : 1024;
+}
+
+std::string MakeLogLines(std::size_t bytes) {
+    std::string log;
+    log.reserve(bytes + 256);
+    char line[256];
+    for (std::size_t i = 0; log.size() < bytes; i++) {
+        bool error = i % 1000 == 0;
+        int size = std::snprintf(line, sizeof(line),
+                                 "2024-05-01 12:%02zu:%02zu [%s] request id=%zu path=/api/v1/items/%zu status=%d %s\n",
+                                 i / 60 % 60, i % 60, error ? "ERROR" : "INFO", i, i * 7 % 10007,
+                                 error ? 500 : 200, error ? "upstream timeout" : "time=12ms");
+        log.append(line, size);
+    }
+    return log;
+}
+
+std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream is(text);
+    std::string line;
+    while (std::getline(is, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TCommand MakeCommand(const std::string& cmdline) {
+    TTokenizer tokenizer;
+    tokenizer.Update(cmdline);
+    return Parse(tokenizer.ParsedTokens())[0];
+}
+
+} // namespace <anonymous>
+
+CLI_BENCHMARK(GrepMatcher) {
+    // std::regex is too slow for a big sample, so the engines are compared on 16 MiB of lines in memory.
+    const std::string sample = MakeLogLines(16 << 20);
+    const std::vector<std::string> lines = SplitLines(sample);
+
+    for (const auto& [pattern, ignoreCase] : std::vector<std::pair<std::string, bool>>{
+             {"ERROR", false}, {"error", true}, {"ERROR.*timeout", false}, {"status=[45]", false}}) {
+        std::string name = "grep " + std::string(ignoreCase ? "-i " : "") + "'" + pattern + "'";
+
+        auto style = std::regex_constants::grep;
+        if (ignoreCase) {
+            style |= std::regex_constants::icase;
+        }
+        std::regex regex(pattern, style);
+        NPrivate::TGrepLineRegexp strategy;
+        Measure(name + ", std::regex", 1, [&]() {
+            for (const std::string& line : lines) {
+                strategy.LineMatches(regex, line);
+            }
+        }, sample.size());
+
+        NPrivate::TGrepMatcher matcher(pattern, ignoreCase, false);
+        Measure(name + ", matcher", 1, [&]() {
+            for (const std::string& line : lines) {
+                matcher.LineMatches(line);
+            }
+        }, sample.size());
+    }
+}
+
+CLI_BENCHMARK(GrepLogFile) {
+    const std::size_t bytes = LogMegabytes() << 20;
+    char filename[] = "/tmp/cli_bench_grep_XXXXXX";
+    int fd = mkstemp(filename);
+    {
+        std::ofstream out(filename);
+        const std::string chunk = MakeLogLines(64 << 20);
+        for (std::size_t written = 0; written < bytes; written += chunk.size()) {
+            out << chunk;
+        }
+    }
+    close(fd);
+
+    TEnvironment env;
+    NPrivate::TGrepExecutor grep(env);
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    const std::string size = std::to_string(LogMegabytes()) + " MiB";
+    for (std::string arguments : {"ERROR", "-i error", "'ERROR.*timeout'", "no-such-text", "-i no-such-text"}) {
+        TCommand command = MakeCommand("grep " + arguments + " " + filename + "\n");
+        Measure("grep " + arguments + ", " + size + " log file", 1, [&]() {
+            std::istringstream is;
+            TPipeIStreamWrapper isw(is);
+            TFdOStream os(devNull);
+            grep.Execute(command, isw, os);
+        }, bytes);
+    }
+
+    close(devNull);
+    unlink(filename);
+}
+
+CLI_BENCHMARK(GrepManyFiles) {
+    // The log is split into 16 files, which are searched with a growing number of jobs up to the number of cores.
+    const std::size_t fileCount = 16;
+    const std::size_t bytes = std::max<std::size_t>(LogMegabytes() / 4, fileCount) << 20;
+    const std::string chunk = MakeLogLines(bytes / fileCount);
+    std::vector<std::string> filenames;
+    std::string arguments;
+    for (std::size_t i = 0; i != fileCount; i++) {
+        char filename[] = "/tmp/cli_bench_grep_XXXXXX";
+        int fd = mkstemp(filename);
+        close(fd);
+        std::ofstream(filename) << chunk;
+        filenames.push_back(filename);
+        arguments += " " + filenames.back();
+    }
+
+    TEnvironment env;
+    NPrivate::TGrepExecutor grep(env);
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    std::vector<std::size_t> jobs = {1, 2, 4, DefaultJobs()};
+    for (std::size_t j = 0; j != jobs.size(); j++) {
+        if (j != 0 && jobs[j] <= jobs[j - 1]) {
+            continue;
+        }
+        TCommand command = MakeCommand("grep -j " + std::to_string(jobs[j]) + " -i error" + arguments + "\n");
+        Measure("grep -j " + std::to_string(jobs[j]) + " -i error, " + std::to_string(fileCount) + " files of "
+                    + std::to_string(chunk.size() >> 20) + " MiB", 1, [&]() {
+            std::istringstream is;
+            TPipeIStreamWrapper isw(is);
+            TFdOStream os(devNull);
+            grep.Execute(command, isw, os);
+        }, chunk.size() * fileCount);
+    }
+
+    close(devNull);
+    for (const std::string& filename : filenames) {
+        unlink(filename.c_str());
+    }
+}
+
+CLI_BENCHMARK(GrepTree) {
+    // A source-like tree: 64 directories of 64 files of 16 KiB each, two levels deep.
+    namespace fs = std::filesystem;
+    std::string root = (fs::temp_directory_path() / "cli_bench_tree_XXXXXX").string();
+    if (mkdtemp(root.data()) == nullptr) {
+        return;
+    }
+    const std::string chunk = MakeLogLines(16 << 10);
+    std::size_t bytes = 0;
+    for (int i = 0; i != 64; i++) {
+        fs::path dir = fs::path(root) / ("dir" + std::to_string(i % 8)) / ("sub" + std::to_string(i));
+        fs::create_directories(dir);
+        for (int j = 0; j != 64; j++) {
+            std::ofstream(dir / ("file" + std::to_string(j) + ".txt")) << chunk;
+            bytes += chunk.size();
+        }
+    }
+
+    TEnvironment env;
+    NPrivate::TGrepExecutor grep(env);
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    std::vector<std::size_t> jobs = {1, 2, 4, DefaultJobs()};
+    for (std::size_t j = 0; j != jobs.size(); j++) {
+        if (j != 0 && jobs[j] <= jobs[j - 1]) {
+            continue;
+        }
+        TCommand command = MakeCommand("grep -r -j " + std::to_string(jobs[j]) + " timeout " + root + "\n");
+        Measure("grep -r -j " + std::to_string(jobs[j]) + " timeout, 4096 files", 5, [&]() {
+            std::istringstream is;
+            TPipeIStreamWrapper isw(is);
+            TFdOStream os(devNull);
+            grep.Execute(command, isw, os);
+        }, bytes);
+    }
+
+    close(devNull);
+    fs::remove_all(root);
+}
+
+CLI_BENCHMARK(GrepRepeated) {
+    // A shell loop running grep with the same pattern over a few lines, so compiling the pattern is most of the work.
+    TEnvironment env;
+    NPrivate::TGrepExecutor grep(env);
+    const std::string input = MakeLogLines(256);
+    for (std::string arguments : {"ERROR", "'ERROR.*timeout'", "-i 'status=[45]'", "'^2024-05'"}) {
+        TCommand command = MakeCommand("grep " + arguments + "\n");
+        Measure("grep " + arguments + ", 3 lines", 2000, [&]() {
+            std::istringstream is(input);
+            TPipeIStreamWrapper isw(is);
+            std::ostringstream os;
+            grep.Execute(command, isw, os);
+        });
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <cli.h>
+#include <common/fd_stream.h>
+#include <common/istream_wrapper.h>
+
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace NCli;
+using namespace NCli::NBench;
+
+namespace {
+
+std::string MakeScript(std::size_t lines) {
+    std::string script;
+    for (std::size_t i = 0; i != lines; i++) {
+        script += "X=" + std::to_string(i) + "\n";
+        script += "echo line $X of the script\n";
+    }
+    return script;
+}
+
+} // namespace <anonymous>
+
+CLI_BENCHMARK(Script) {
+    // The output goes to a real descriptor, so that every flush costs a system call, as it does on a terminal.
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    const std::string script = MakeScript(50000);
+    char* envp[] = {nullptr};
+
+    Measure("100000 lines, interactive", 1, [&]() {
+        std::istringstream is(script);
+        TStdinIStreamWrapper isw(is);
+        TFdOStream out(devNull);
+        std::ostringstream err;
+        RunMain(isw, out, err, envp);
+    }, script.size());
+    Measure("100000 lines, batch", 1, [&]() {
+        std::istringstream is;
+        TStdinIStreamWrapper isw(is);
+        TFdOStream out(devNull);
+        std::ostringstream err;
+        RunScript(script, isw, out, err, envp);
+    }, script.size());
+
+    close(devNull);
+}
@@ -0,0 +1,69 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <tokenizer/tokenizer.h>
+
+#include <string>
+
+using namespace NCli;
+using namespace NCli::NBench;
+
+namespace {
+
+std::string MakeScript(std::size_t bytes) {
+    const std::string line = "grep -i \"some pattern\" file_$i.txt | wc -l | cat 'quoted $VAR' plain\\ words\n";
+    std::string script;
+    script.reserve(bytes + line.size());
+    while (script.size() < bytes) {
+        script += line;
+    }
+    return script;
+}
+
+} // namespace <anonymous>
+
+CLI_BENCHMARK(TokenizeScript) {
+    std::string script = MakeScript(std::size_t(4) << 20);
+
+    Measure("tokenize a 4 MiB script", 20, [&]() {
+        TTokenizer tokenizer;
+        tokenizer.Update(script);
+    }, script.size());
+}
+
+CLI_BENCHMARK(TokenizePlainWords) {
+    std::string arguments = "echo";
+    while (arguments.size() < (std::size_t(1) << 20)) {
+        arguments += " argument_number_" + std::to_string(arguments.size());
+    }
+    arguments += "\n";
+    Measure("tokenize a 1 MiB argument list", 50, [&]() {
+        TTokenizer tokenizer;
+        tokenizer.Update(arguments);
+    }, arguments.size());
+
+    std::string heredoc = "cat \"";
+    while (heredoc.size() < (std::size_t(1) << 20)) {
+        heredoc += "A line of a heredoc-sized text with $VARIABLES and 'quotes' inside.\n";
+    }
+    heredoc += "\"\n";
+    Measure("tokenize a 1 MiB double-quoted text", 50, [&]() {
+        TTokenizer tokenizer;
+        tokenizer.Update(heredoc);
+    }, heredoc.size());
+}
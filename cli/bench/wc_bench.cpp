@@ -0,0 +1,206 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <common/fd_stream.h>
+#include <executor/executor.h>
+#include <executor/private/builtin_executors.h>
+#include <tokenizer/tokenizer.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace NCli;
+using namespace NCli::NBench;
+
+namespace {
+
+/**
+ * Returns the size of the counted file in MiB: 1024 unless set by CLI_BENCH_WC_MB.
+ */
+std::size_t FileMegabytes() {
+    const char* value = std::getenv("CLI_BENCH_WC_MB");
+    return value != nullptr ? std::strtoul(value, nullptr, 10) : 1024;
+}
+
+std::string MakeText(std::size_t bytes) {
+    std::string text;
+    text.reserve(bytes + 256);
+    char line[256];
+    for (std::size_t i = 0; text.size() < bytes; i++) {
+        int size = std::snprintf(line, sizeof(line), "%zu\tthe quick brown fox  jumps over %zu lazy dogs%s\n",
+                                 i, i % 97, i % 13 == 0 ? "" : " again and again");
+        text.append(line, size);
+    }
+    return text;
+}
+
+TCommand MakeCommand(const std::string& cmdline) {
+    TTokenizer tokenizer;
+    tokenizer.Update(cmdline);
+    return Parse(tokenizer.ParsedTokens())[0];
+}
+
+/**
+ * Runs the external command with the arguments, its output going to /dev/null.
+ */
+void RunExternal(std::vector<std::string> args) {
+    std::vector<char*> argv;
+    for (std::string& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ) == 0) {
+        waitpid(pid, nullptr, 0);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+}
+
+/**
+ * Returns the peak resident set size of the process in KiB.
+ */
+long MaxRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+} // namespace <anonymous>
+
+CLI_BENCHMARK(WcFile) {
+    const std::size_t bytes = FileMegabytes() << 20;
+    char filename[] = "/tmp/cli_bench_wc_XXXXXX";
+    close(mkstemp(filename));
+    {
+        std::ofstream out(filename);
+        const std::string chunk = MakeText(64 << 20);
+        for (std::size_t written = 0; written < bytes; written += chunk.size()) {
+            out << chunk;
+        }
+    }
+
+    TEnvironment env;
+    NPrivate::TWcExecutor wc(env);
+    const std::string size = std::to_string(FileMegabytes()) + " MiB file";
+    TCommand command = MakeCommand(std::string("wc ") + filename + "\n");
+    Measure("wc, " + size, 1, [&]() {
+        std::istringstream is;
+        TPipeIStreamWrapper isw(is);
+        std::ostringstream os;
+        wc.Execute(command, isw, os);
+    }, bytes);
+    for (std::string flag : {"-l", "-c"}) {
+        TCommand selected = MakeCommand("wc " + flag + " " + filename + "\n");
+        Measure("wc " + flag + ", " + size, 1, [&]() {
+            std::istringstream is;
+            TPipeIStreamWrapper isw(is);
+            std::ostringstream os;
+            wc.Execute(selected, isw, os);
+        }, bytes);
+    }
+    Measure("coreutils wc, " + size, 1, [&]() {
+        RunExternal({"wc", filename});
+    }, bytes);
+    Measure("coreutils wc -lwc, " + size, 1, [&]() {
+        RunExternal({"wc", "-l", "-w", "-c", filename});
+    }, bytes);
+    Measure("coreutils wc -l, " + size, 1, [&]() {
+        RunExternal({"wc", "-l", filename});
+    }, bytes);
+
+    unlink(filename);
+}
+
+CLI_BENCHMARK(WcManyFiles) {
+    const std::string chunk = MakeText(1 << 20);
+    std::vector<std::string> args = {"wc"};
+    std::string arguments;
+    for (int i = 0; i != 256; i++) {
+        char filename[] = "/tmp/cli_bench_wc_XXXXXX";
+        close(mkstemp(filename));
+        std::ofstream(filename) << chunk;
+        args.push_back(filename);
+        arguments += std::string(" ") + filename;
+    }
+
+    TEnvironment env;
+    NPrivate::TWcExecutor wc(env);
+    TCommand command = MakeCommand("wc" + arguments + "\n");
+    Measure("wc, 256 files of 1 MiB", 3, [&]() {
+        std::istringstream is;
+        TPipeIStreamWrapper isw(is);
+        std::ostringstream os;
+        wc.Execute(command, isw, os);
+    }, chunk.size() * 256);
+    Measure("coreutils wc, 256 files of 1 MiB", 3, [&]() {
+        RunExternal(args);
+    }, chunk.size() * 256);
+
+    for (std::size_t i = 1; i != args.size(); i++) {
+        unlink(args[i].c_str());
+    }
+}
+
+CLI_BENCHMARK(WcPipe) {
+    // The pipe carries four times the file size, written from memory, while the memory of the process is watched.
+    const std::string chunk = MakeText(16 << 20);
+    const std::size_t rounds = (FileMegabytes() << 22) / chunk.size();
+    const std::size_t bytes = rounds * chunk.size();
+
+    TEnvironment env;
+    NPrivate::TWcExecutor wc(env);
+    TCommand command = MakeCommand("wc\n");
+    long rss = MaxRssKb();
+    Measure("wc, " + std::to_string(bytes >> 20) + " MiB through a pipe", 1, [&]() {
+        int fds[2];
+        if (pipe(fds) == -1) {
+            return;
+        }
+        std::thread writer([&]() {
+            for (std::size_t i = 0; i != rounds; i++) {
+                WriteAll(fds[1], chunk.data(), chunk.size());
+            }
+            close(fds[1]);
+        });
+        {
+            TFdIStream in(fds[0]);
+            TPipeIStreamWrapper isw(in);
+            std::ostringstream os;
+            wc.Execute(command, isw, os);
+        }
+        writer.join();
+        close(fds[0]);
+    }, bytes);
+    std::cout << "  peak memory growth: " << (MaxRssKb() - rss) << " KiB" << std::endl;
+}
@@ -23,9 +23,33 @@
 #include <tokenizer/tokenizer.h>
 #include <parser/parse.h>
 
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
 namespace NCli {
 namespace {
 
+/**
+ * Executes a complete command.
+ */
+void ExecuteTokens(std::vector<TToken>&& tokens,
+                   IIStreamWrapper& in,
+                   std::ostream& out,
+                   TEnvironment& env,
+                   TVarExpander& varExpander) {
+    std::vector<TToken> expanded = varExpander.Expand(std::move(tokens));
+
+    TFullCommand command = Parse(std::move(expanded));
+
+    Execute(command, env, in, out);
+}
+
 void LoopIteration(IIStreamWrapper& in,
                    std::ostream& out,
                    std::ostream& err,
@@ -42,12 +66,98 @@ void LoopIteration(IIStreamWrapper& in,
         tokenizer.Update(s);
     } while (tokenizer.State() == TTokenizer::EState::WAITING);
 
-    std::vector<TToken> tokens = varExpander.Expand(tokenizer.ParsedTokens());
+    ExecuteTokens(tokenizer.TakeTokens(), in, out, env, varExpander);
+}
+
+/**
+ * Executes the commands of a script as the blocks of it are fed.
+ *
+ * The blocks are split into lines, which are passed to the tokenizer right from the block, unless a line spans two
+ * blocks. A command is executed as soon as its last line is passed.
+ */
+class TScriptRunner final {
+public:
+    TScriptRunner(IIStreamWrapper& in, std::ostream& out, std::ostream& err, char* envp[])
+        : In_(in)
+        , Out_(out)
+        , Err_(err)
+        , Environment_(LoadGlobalEnvironment(const_cast<const char**>(envp)))
+        , VarExpander_(Environment_)
+    {}
 
-    TFullCommand command = Parse(tokens);
+    /**
+     * Runs the complete lines of the next block of the script.
+     *
+     * @return Whether the script must go on, that is, exit has not been called.
+     */
+    bool Feed(std::string_view block) {
+        while (!block.empty()) {
+            std::size_t newline = block.find('\n');
+            if (newline == std::string_view::npos) {
+                Partial_.append(block);
+                break;
+            }
+            std::string_view line = block.substr(0, newline + 1);
+            block.remove_prefix(newline + 1);
+            if (!Partial_.empty()) {
+                Partial_.append(line);
+                line = Partial_;
+            }
+            bool goOn = RunLine(line);
+            Partial_.clear();
+            if (!goOn) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-    Execute(command, env, in, out);
-}
+    /**
+     * Runs the last line of the script, which may lack the newline, and flushes the output.
+     */
+    void Finish() {
+        if (!Partial_.empty()) {
+            Partial_.push_back('\n');
+            if (!RunLine(Partial_)) {
+                Out_.flush();
+                return;
+            }
+        }
+        if (Tokenizer_.State() == TTokenizer::EState::WAITING) {
+            Err_ << "cli: unexpected end of file" << std::endl;
+        }
+        Out_.flush();
+    }
+
+private:
+    bool RunLine(std::string_view line) {
+        try {
+            Tokenizer_.Update(line);
+            if (Tokenizer_.State() == TTokenizer::EState::DONE) {
+                ExecuteTokens(Tokenizer_.TakeTokens(), In_, Out_, Environment_, VarExpander_);
+            }
+        } catch (TExitException&) {
+            return false;
+        } catch (std::exception& e) {
+            Tokenizer_ = TTokenizer();
+            Err_ << e.what() << std::endl;
+        } catch(...) {
+            Tokenizer_ = TTokenizer();
+            Err_ << "cli: unknown error" << std::endl;
+        }
+        return true;
+    }
+
+    IIStreamWrapper& In_;
+    std::ostream& Out_;
+    std::ostream& Err_;
+    TEnvironment Environment_;
+    TVarExpander VarExpander_;
+    TTokenizer Tokenizer_;
+    std::string Partial_;
+};
+
+constexpr std::size_t SCRIPT_BLOCK_SIZE = 1 << 16;
 
 } // namespace <anonymous>
 
@@ -67,4 +177,31 @@ void RunMain(IIStreamWrapper& in, std::ostream& out, std::ostream& err, char* en
     }
 }
 
+bool RunScript(int scriptFd, IIStreamWrapper& in, std::ostream& out, std::ostream& err, char* envp[]) {
+    TScriptRunner runner(in, out, err, envp);
+    std::vector<char> block(SCRIPT_BLOCK_SIZE);
+    while (true) {
+        ssize_t size = read(scriptFd, block.data(), block.size());
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size < 0) {
+            err << "cli: " << std::strerror(errno) << std::endl;
+            runner.Finish();
+            return false;
+        }
+        if (size == 0 || !runner.Feed(std::string_view(block.data(), size))) {
+            break;
+        }
+    }
+    runner.Finish();
+    return true;
+}
+
+void RunScript(std::string_view script, IIStreamWrapper& in, std::ostream& out, std::ostream& err, char* envp[]) {
+    TScriptRunner runner(in, out, err, envp);
+    runner.Feed(script);
+    runner.Finish();
+}
+
 } // namespace NCli
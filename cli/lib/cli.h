@@ -17,6 +17,7 @@
 #pragma once
 
 #include <iostream>
+#include <string_view>
 #include <common/istream_wrapper.h>
 
 namespace NCli {
@@ -27,4 +28,19 @@ namespace NCli {
  */
 void RunMain(IIStreamWrapper& is, std::ostream& os, std::ostream& err, char* envp[]);
 
+/**
+ * Runs a script non-interactively, reading it from the file descriptor {@arg scriptFd}, as "cli script.sh" does.
+ *
+ * Unlike {@link NCli::RunMain}, no prompt is printed and {@arg os} is not flushed after each command, so it is supposed
+ * to be fully buffered. The script is read in large blocks. The commands read their input from {@arg is}.
+ *
+ * @return Whether the whole script was read, that is, it did not fail to be read.
+ */
+bool RunScript(int scriptFd, IIStreamWrapper& is, std::ostream& os, std::ostream& err, char* envp[]);
+
+/**
+ * The same as the other overload, but the script is given as a string, as "cli -c script" does.
+ */
+void RunScript(std::string_view script, IIStreamWrapper& is, std::ostream& os, std::ostream& err, char* envp[]);
+
 } // namespace NCli
\ No newline at end of file
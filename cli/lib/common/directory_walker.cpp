@@ -0,0 +1,306 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "directory_walker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace NCli {
+
+namespace {
+
+/**
+ * An open directory, closed when the last task referring to it is done.
+ */
+class TDirectory final {
+public:
+    explicit TDirectory(int fd)
+        : Fd_(fd)
+    {}
+
+    ~TDirectory() {
+        close(Fd_);
+    }
+
+    TDirectory(const TDirectory&) = delete;
+    TDirectory& operator=(const TDirectory&) = delete;
+
+    int Fd() const {
+        return Fd_;
+    }
+
+private:
+    int Fd_;
+};
+
+/**
+ * A file or a directory to be visited: {@arg Name} in {@arg Parent}, or in the current directory if there is no parent.
+ */
+struct TTask {
+    std::shared_ptr<TDirectory> Parent;
+    std::string Name;
+    std::string Path;
+    bool IsDirectory;
+};
+
+/**
+ * The tasks of a single thread: it takes the newest ones, the other threads steal the oldest ones.
+ */
+class TTaskDeque final {
+public:
+    void Push(TTask task) {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        Tasks_.push_back(std::move(task));
+    }
+
+    std::optional<TTask> PopNewest() {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        if (Tasks_.empty()) {
+            return std::nullopt;
+        }
+        TTask task = std::move(Tasks_.back());
+        Tasks_.pop_back();
+        return task;
+    }
+
+    std::optional<TTask> StealOldest() {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        if (Tasks_.empty()) {
+            return std::nullopt;
+        }
+        TTask task = std::move(Tasks_.front());
+        Tasks_.pop_front();
+        return task;
+    }
+
+private:
+    std::mutex Mutex_;
+    std::deque<TTask> Tasks_;
+};
+
+/**
+ * The header of a record returned by getdents64, followed by the null-terminated name.
+ */
+struct TDirentHeader {
+    std::uint64_t Inode;
+    std::int64_t Offset;
+    unsigned short RecordLength;
+    unsigned char Type;
+};
+
+constexpr std::size_t DIRENT_NAME_OFFSET = offsetof(TDirentHeader, Type) + 1;
+
+constexpr std::size_t DIRENT_BUFFER_SIZE = 1 << 15;
+
+class TWalker final {
+public:
+    TWalker(std::size_t jobs, const TVisitFile& visit, const TWalkError& fail)
+        : Deques_(jobs)
+        , Visit_(visit)
+        , Fail_(fail)
+    {}
+
+    void Run(TTask root) {
+        Push(0, std::move(root));
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < Deques_.size(); i++) {
+            threads.emplace_back([this, i]() {
+                Work(i);
+            });
+        }
+        Work(0);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        if (Error_) {
+            std::rethrow_exception(Error_);
+        }
+    }
+
+private:
+    void Push(std::size_t self, TTask task) {
+        Pending_++;
+        Deques_[self].Push(std::move(task));
+        Queued_++;
+        if (Sleeping_.load() > 0) {
+            std::lock_guard<std::mutex> lock(Mutex_);
+            Changed_.notify_one();
+        }
+    }
+
+    std::optional<TTask> Take(std::size_t self) {
+        while (true) {
+            if (Stop_.load()) {
+                return std::nullopt;
+            }
+            std::optional<TTask> task = Deques_[self].PopNewest();
+            for (std::size_t i = 1; !task.has_value() && i < Deques_.size(); i++) {
+                task = Deques_[(self + i) % Deques_.size()].StealOldest();
+            }
+            if (task.has_value()) {
+                Queued_--;
+                return task;
+            }
+
+            std::unique_lock<std::mutex> lock(Mutex_);
+            Sleeping_++;
+            Changed_.wait(lock, [this]() {
+                return Queued_.load() > 0 || Pending_.load() == 0 || Stop_.load();
+            });
+            Sleeping_--;
+            if (Pending_.load() == 0) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    void Work(std::size_t self) {
+        std::vector<char> buffer(DIRENT_BUFFER_SIZE);
+        while (std::optional<TTask> task = Take(self)) {
+            try {
+                if (task->IsDirectory) {
+                    ReadDirectory(self, task.value(), buffer);
+                } else {
+                    Visit_(task->Parent != nullptr ? task->Parent->Fd() : AT_FDCWD, task->Name, task->Path);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(Mutex_);
+                if (!Error_) {
+                    Error_ = std::current_exception();
+                }
+                Stop_ = true;
+                Changed_.notify_all();
+            }
+            task.reset();
+
+            if (--Pending_ == 0) {
+                std::lock_guard<std::mutex> lock(Mutex_);
+                Changed_.notify_all();
+            }
+        }
+    }
+
+    void ReadDirectory(std::size_t self, const TTask& task, std::vector<char>& buffer) {
+        int parentFd = task.Parent != nullptr ? task.Parent->Fd() : AT_FDCWD;
+        int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (task.Parent != nullptr ? O_NOFOLLOW : 0);
+        int fd = openat(parentFd, task.Name.c_str(), flags);
+        if (fd == -1) {
+            Fail_(task.Path, errno);
+            return;
+        }
+        auto directory = std::make_shared<TDirectory>(fd);
+        std::string prefix = task.Path;
+        if (!prefix.empty() && prefix.back() != '/') {
+            prefix += '/';
+        }
+
+        // The subdirectories are pushed before the files, so that the files are taken first and the directory is
+        // closed before going deeper.
+        std::vector<TTask> files;
+        while (true) {
+            long got = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                Fail_(task.Path, errno);
+                break;
+            }
+            if (got == 0) {
+                break;
+            }
+            for (long pos = 0; pos < got;) {
+                TDirentHeader header;
+                std::memcpy(&header, buffer.data() + pos, sizeof(header));
+                const char* name = buffer.data() + pos + DIRENT_NAME_OFFSET;
+                pos += header.RecordLength;
+
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                    continue;
+                }
+                unsigned char type = header.Type;
+                if (type == DT_UNKNOWN) {
+                    struct stat st;
+                    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+                        continue;
+                    }
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+                }
+                if (type == DT_DIR) {
+                    Push(self, TTask{directory, name, prefix + name, true});
+                } else if (type == DT_REG) {
+                    files.push_back(TTask{directory, name, prefix + name, false});
+                }
+            }
+        }
+        for (TTask& file : files) {
+            Push(self, std::move(file));
+        }
+    }
+
+    std::vector<TTaskDeque> Deques_;
+    const TVisitFile& Visit_;
+    const TWalkError& Fail_;
+
+    std::atomic<std::size_t> Pending_{0};
+    std::atomic<std::size_t> Queued_{0};
+    std::atomic<std::size_t> Sleeping_{0};
+    std::atomic<bool> Stop_{false};
+    std::mutex Mutex_;
+    std::condition_variable Changed_;
+    std::exception_ptr Error_;
+};
+
+} // namespace <anonymous>
+
+void WalkFiles(const std::string& root, const std::string& rootName, std::size_t jobs, const TVisitFile& visit,
+               const TWalkError& fail) {
+    struct stat st;
+    if (stat(root.c_str(), &st) == -1) {
+        fail(rootName, errno);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        visit(AT_FDCWD, root, rootName);
+        return;
+    }
+
+    TWalker walker(std::max<std::size_t>(jobs, 1), visit, fail);
+    walker.Run(TTask{nullptr, root, rootName, true});
+}
+
+} // namespace NCli
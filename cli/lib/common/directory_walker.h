@@ -0,0 +1,50 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace NCli {
+
+/**
+ * Called for a regular file found by {@link WalkFiles}: the file is {@arg name} in the directory open as {@arg dirFd},
+ * and {@arg path} is its path starting with the name of the root.
+ */
+using TVisitFile = std::function<void(int dirFd, const std::string& name, const std::string& path)>;
+
+/**
+ * Called for a file or directory {@link WalkFiles} fails to open or read, with the error number.
+ */
+using TWalkError = std::function<void(const std::string& path, int error)>;
+
+/**
+ * Calls {@arg visit} for every regular file in the directory {@arg root} and all of its subdirectories, or for
+ * {@arg root} itself if it is not a directory. Symbolic links below the root are not followed. The paths passed to
+ * the callbacks start with {@arg rootName} instead of {@arg root}; an empty name makes them relative to the root.
+ *
+ * The directories are read with getdents64 on {@arg jobs} threads, the calling one included, and the callbacks are
+ * called on the same threads as soon as a file is found, so they must be safe to call concurrently. Every thread keeps
+ * its own stack of directories and files and takes the oldest ones from the others when it runs out of work.
+ *
+ * An exception thrown by a callback stops the walk and is rethrown.
+ */
+void WalkFiles(const std::string& root, const std::string& rootName, std::size_t jobs, const TVisitFile& visit,
+               const TWalkError& fail);
+
+} // namespace NCli
@@ -16,7 +16,7 @@
 
 #pragma once
 
-#include <vector>
+#include <cstdint>
 
 namespace NCli {
 
@@ -26,7 +26,7 @@ namespace NCli {
  * Many internal processes, such as tokenization, assumes same escaped and unescaped characters to be unequal. For
  * example, input string "do\ a\ thing" is assumed to be a single token.
  */
-enum class ECharEscapeStatus {
+enum class ECharEscapeStatus : std::uint8_t {
     ESCAPED,
     UNESCAPED
 };
@@ -34,7 +34,7 @@ enum class ECharEscapeStatus {
 /**
  * Denotes whether some part of a character should be ignored by internal processes.
  */
-enum class ECharIgnoranceStatus {
+enum class ECharIgnoranceStatus : std::uint8_t {
     /**
      * No part of a character should be ignored.
      */
@@ -58,8 +58,8 @@ enum class ECharIgnoranceStatus {
  *
  * Actual flags are the "escape status" and the "ignorance status".
  *
- * Instances of TExtChar are supposed to be stored in a std::vector, so the class is destructible, copy-constructible
- * and -assignable and move-constructible and -assignable.
+ * Instances of TExtChar are small values passed by copy (tokens store the characters and the flags separately), so
+ * the class is destructible, copy-constructible and -assignable and move-constructible and -assignable.
  */
 class TExtChar final {
 public:
@@ -0,0 +1,294 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fd_stream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace NCli {
+
+bool WriteAll(int fd, const char* data, std::size_t size) {
+    while (size != 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd pfd{fd, POLLOUT, 0};
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+namespace {
+
+/**
+ * The most data moved by a single system call of {@link CopyFd}, so that it is interrupted in a reasonable time.
+ */
+constexpr std::size_t COPY_CHUNK_SIZE = 1 << 30;
+
+/**
+ * The size of the buffer {@link CopyFd} falls back to.
+ */
+constexpr std::size_t COPY_BUFFER_SIZE = 1 << 20;
+
+/**
+ * Moves the data with {@arg move}, which makes a single system call, until the end of the input.
+ *
+ * @return 1 if all the data was moved, 0 if the kernel does not support the call for these descriptors, so another way
+ * has to be used for the rest of the data, or -1 on an error.
+ */
+template <typename TMove>
+int MoveInKernel(int from, int to, TMove&& move) {
+    while (true) {
+        ssize_t moved = move(from, to, COPY_CHUNK_SIZE);
+        if (moved > 0) {
+            continue;
+        }
+        if (moved == 0) {
+            return 1;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // Either side may be a non-blocking pipe; the output is waited for first if it is full.
+            pollfd out{to, POLLOUT, 0};
+            if (poll(&out, 1, 0) == 1) {
+                pollfd in{from, POLLIN, 0};
+                poll(&in, 1, -1);
+            } else {
+                poll(&out, 1, -1);
+            }
+            continue;
+        }
+        if (errno == EINVAL || errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EBADF) {
+            return 0;
+        }
+        return -1;
+    }
+}
+
+} // namespace <anonymous>
+
+ssize_t ReadSome(int fd, char* data, std::size_t size) {
+    while (true) {
+        ssize_t status = read(fd, data, size);
+        if (status < 0 && errno == EINTR) {
+            continue;
+        }
+        return status;
+    }
+}
+
+bool CopyFd(int from, int to) {
+    struct stat in;
+    struct stat out;
+    if (fstat(from, &in) == -1 || fstat(to, &out) == -1) {
+        return false;
+    }
+
+    int status = 0;
+    if (S_ISREG(in.st_mode) && S_ISREG(out.st_mode)) {
+        status = MoveInKernel(from, to, [](int from, int to, std::size_t size) {
+            return copy_file_range(from, nullptr, to, nullptr, size, 0);
+        });
+    }
+    if (status == 0 && (S_ISFIFO(in.st_mode) || S_ISFIFO(out.st_mode))) {
+        status = MoveInKernel(from, to, [](int from, int to, std::size_t size) {
+            return splice(from, nullptr, to, nullptr, size, SPLICE_F_MOVE);
+        });
+    }
+    if (status == 0 && S_ISREG(in.st_mode)) {
+        status = MoveInKernel(from, to, [](int from, int to, std::size_t size) {
+            return sendfile(to, from, nullptr, size);
+        });
+    }
+    if (status != 0) {
+        return status == 1;
+    }
+
+    std::unique_ptr<char[]> buffer(new char[COPY_BUFFER_SIZE]);
+    while (true) {
+        ssize_t got = read(from, buffer.get(), COPY_BUFFER_SIZE);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd pfd{from, POLLIN, 0};
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        if (got <= 0) {
+            return got == 0;
+        }
+        if (!WriteAll(to, buffer.get(), got)) {
+            return false;
+        }
+    }
+}
+
+TFdOStreamBuf::TFdOStreamBuf(int fd, std::size_t bufferSize, EFlushPolicy policy)
+    : Fd_(fd)
+    , Policy_(policy)
+    , Buffer_(bufferSize)
+{
+    SetUsed(0);
+}
+
+TFdOStreamBuf::~TFdOStreamBuf() {
+    FlushBuffer();
+}
+
+int TFdOStreamBuf::Fd() const {
+    return Fd_;
+}
+
+TFdOStreamBuf::int_type TFdOStreamBuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return FlushBuffer() ? traits_type::not_eof(c) : traits_type::eof();
+    }
+    char character = traits_type::to_char_type(c);
+    return Append(&character, 1) ? c : traits_type::eof();
+}
+
+std::streamsize TFdOStreamBuf::xsputn(const char* s, std::streamsize n) {
+    return Append(s, n) ? n : 0;
+}
+
+int TFdOStreamBuf::sync() {
+    return FlushBuffer() ? 0 : -1;
+}
+
+bool TFdOStreamBuf::Append(const char* data, std::size_t size) {
+    std::size_t used = pptr() - pbase();
+    if (size > Buffer_.size() - used) {
+        if (!FlushBuffer()) {
+            return false;
+        }
+        used = 0;
+    }
+    if (size >= Buffer_.size()) {
+        return WriteAll(Fd_, data, size);
+    }
+    traits_type::copy(Buffer_.data() + used, data, size);
+    SetUsed(used + size);
+    if (Policy_ == EFlushPolicy::LINE && std::memchr(data, '\n', size) != nullptr) {
+        return FlushBuffer();
+    }
+    return true;
+}
+
+void TFdOStreamBuf::SetUsed(std::size_t used) {
+    // With the line policy, the put area ends right at the data, so every write comes through Append and is checked
+    // for a newline. Otherwise, the characters are put right into the buffer until it is full.
+    char* end = Policy_ == EFlushPolicy::LINE ? Buffer_.data() + used : Buffer_.data() + Buffer_.size();
+    setp(Buffer_.data(), end);
+    pbump(static_cast<int>(used));
+}
+
+bool TFdOStreamBuf::FlushBuffer() {
+    bool ok = WriteAll(Fd_, pbase(), pptr() - pbase());
+    SetUsed(0);
+    return ok;
+}
+
+TFdOStream::TFdOStream(int fd, EFlushPolicy policy, std::size_t bufferSize)
+    : std::ostream(nullptr)
+    , Buf_(fd, bufferSize, policy)
+{
+    rdbuf(&Buf_);
+}
+
+int TFdOStream::Fd() const {
+    return Buf_.Fd();
+}
+
+TFdIStreamBuf::TFdIStreamBuf(int fd, std::size_t bufferSize)
+    : Fd_(fd)
+    , Buffer_(bufferSize)
+{
+    setg(Buffer_.data(), Buffer_.data(), Buffer_.data());
+}
+
+int TFdIStreamBuf::Fd() const {
+    return Fd_;
+}
+
+TFdIStreamBuf::int_type TFdIStreamBuf::underflow() {
+    if (gptr() == egptr()) {
+        ssize_t size = ReadSome(Fd_, Buffer_.data(), Buffer_.size());
+        if (size <= 0) {
+            setg(Buffer_.data(), Buffer_.data(), Buffer_.data());
+            return traits_type::eof();
+        }
+        setg(Buffer_.data(), Buffer_.data(), Buffer_.data() + size);
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize TFdIStreamBuf::xsgetn(char* s, std::streamsize n) {
+    std::streamsize done = std::min<std::streamsize>(n, egptr() - gptr());
+    traits_type::copy(s, gptr(), done);
+    gbump(static_cast<int>(done));
+    while (done != n) {
+        if (static_cast<std::size_t>(n - done) < Buffer_.size()) {
+            if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+                break;
+            }
+            std::streamsize chunk = std::min<std::streamsize>(n - done, egptr() - gptr());
+            traits_type::copy(s + done, gptr(), chunk);
+            gbump(static_cast<int>(chunk));
+            done += chunk;
+        } else {
+            ssize_t size = ReadSome(Fd_, s + done, n - done);
+            if (size <= 0) {
+                break;
+            }
+            done += size;
+        }
+    }
+    return done;
+}
+
+TFdIStream::TFdIStream(int fd, std::size_t bufferSize)
+    : std::istream(nullptr)
+    , Buf_(fd, bufferSize)
+{
+    rdbuf(&Buf_);
+}
+
+int TFdIStream::Fd() const {
+    return Buf_.Fd();
+}
+
+} // namespace NCli
@@ -0,0 +1,208 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace NCli {
+
+/**
+ * Describes when a {@link NCli::TFdOStreamBuf} writes the buffered data besides the moments it is full, synchronized or
+ * destroyed.
+ */
+enum class EFlushPolicy {
+    /**
+     * Never: the data is written in blocks of the buffer size. This suits pipes and files.
+     */
+    FULL,
+
+    /**
+     * After every write containing a newline, so that the output appears line by line. This suits terminals.
+     */
+    LINE
+};
+
+/**
+ * A stream buffer writing to a file descriptor.
+ *
+ * The buffer does not own the descriptor: it is never closed by the buffer. All the buffered data is written when the
+ * buffer is synchronized or destroyed, and when it is full. Partial writes and interrupted system calls are handled.
+ */
+class TFdOStreamBuf final : public std::streambuf {
+public:
+    /**
+     * Constructs a buffer writing to {@arg fd}.
+     */
+    explicit TFdOStreamBuf(int fd, std::size_t bufferSize = 1 << 16, EFlushPolicy policy = EFlushPolicy::FULL);
+
+    /**
+     * Writes the buffered data.
+     */
+    ~TFdOStreamBuf() override;
+
+    /**
+     * The buffer refers to a descriptor it does not own, so it is not copy-constructible nor copy-assignable nor
+     * move-constructible nor move-assignable.
+     */
+    TFdOStreamBuf(const TFdOStreamBuf&) = delete;
+    TFdOStreamBuf& operator=(const TFdOStreamBuf&) = delete;
+    TFdOStreamBuf(TFdOStreamBuf&&) = delete;
+    TFdOStreamBuf& operator=(TFdOStreamBuf&&) = delete;
+
+    /**
+     * Returns the descriptor the buffer writes to.
+     */
+    int Fd() const;
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    bool Append(const char* data, std::size_t size);
+    void SetUsed(std::size_t used);
+    bool FlushBuffer();
+
+    int Fd_;
+    EFlushPolicy Policy_;
+    std::vector<char> Buffer_;
+};
+
+/**
+ * An output stream writing to a file descriptor through {@link NCli::TFdOStreamBuf}.
+ *
+ * The stream is set to the bad state as soon as a write fails, for example, when the reader of a pipe has exited.
+ */
+class TFdOStream final : public std::ostream {
+public:
+    /**
+     * Constructs a stream writing to {@arg fd} through a buffer of {@arg bufferSize} bytes. The descriptor is not owned
+     * by the stream.
+     */
+    explicit TFdOStream(int fd, EFlushPolicy policy = EFlushPolicy::FULL, std::size_t bufferSize = 1 << 16);
+
+    ~TFdOStream() override = default;
+    TFdOStream(const TFdOStream&) = delete;
+    TFdOStream& operator=(const TFdOStream&) = delete;
+    TFdOStream(TFdOStream&&) = delete;
+    TFdOStream& operator=(TFdOStream&&) = delete;
+
+    /**
+     * Returns the descriptor the stream writes to.
+     */
+    int Fd() const;
+
+private:
+    TFdOStreamBuf Buf_;
+};
+
+/**
+ * A stream buffer reading from a file descriptor.
+ *
+ * The buffer does not own the descriptor: it is never closed by the buffer.
+ */
+class TFdIStreamBuf final : public std::streambuf {
+public:
+    /**
+     * Constructs a buffer reading from {@arg fd}.
+     */
+    explicit TFdIStreamBuf(int fd, std::size_t bufferSize = 1 << 16);
+
+    ~TFdIStreamBuf() override = default;
+
+    /**
+     * The buffer refers to a descriptor it does not own, so it is not copy-constructible nor copy-assignable nor
+     * move-constructible nor move-assignable.
+     */
+    TFdIStreamBuf(const TFdIStreamBuf&) = delete;
+    TFdIStreamBuf& operator=(const TFdIStreamBuf&) = delete;
+    TFdIStreamBuf(TFdIStreamBuf&&) = delete;
+    TFdIStreamBuf& operator=(TFdIStreamBuf&&) = delete;
+
+    /**
+     * Returns the descriptor the buffer reads from.
+     */
+    int Fd() const;
+
+protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char* s, std::streamsize n) override;
+
+private:
+    int Fd_;
+    std::vector<char> Buffer_;
+};
+
+/**
+ * An input stream reading from a file descriptor through {@link NCli::TFdIStreamBuf}.
+ */
+class TFdIStream final : public std::istream {
+public:
+    /**
+     * Constructs a stream reading from {@arg fd} through a buffer of {@arg bufferSize} bytes. The descriptor is not
+     * owned by the stream.
+     */
+    explicit TFdIStream(int fd, std::size_t bufferSize = 1 << 16);
+
+    ~TFdIStream() override = default;
+    TFdIStream(const TFdIStream&) = delete;
+    TFdIStream& operator=(const TFdIStream&) = delete;
+    TFdIStream(TFdIStream&&) = delete;
+    TFdIStream& operator=(TFdIStream&&) = delete;
+
+    /**
+     * Returns the descriptor the stream reads from.
+     */
+    int Fd() const;
+
+private:
+    TFdIStreamBuf Buf_;
+};
+
+/**
+ * Reads at most {@arg size} bytes from {@arg fd} to {@arg data}, retrying on interrupted system calls.
+ *
+ * @return Number of bytes read, zero on EOF, or -1 on error with errno set.
+ */
+ssize_t ReadSome(int fd, char* data, std::size_t size);
+
+/**
+ * Writes the whole {@arg size} bytes from {@arg data} to {@arg fd}, retrying on partial writes and interrupted system
+ * calls. A non-blocking descriptor is waited for with poll(2) when it is full.
+ *
+ * @return Whether all the data was written.
+ */
+bool WriteAll(int fd, const char* data, std::size_t size);
+
+/**
+ * Copies the data from {@arg from} to {@arg to} up to the end of the input, inside the kernel where it is possible:
+ * with copy_file_range(2) between regular files, with splice(2) to or from a pipe and with sendfile(2) from a regular
+ * file to anything else. When the kernel refuses to copy between the descriptors, the rest of the data goes through a
+ * 1 MiB buffer with read(2) and write(2). Non-blocking descriptors are waited for with poll(2).
+ *
+ * @return Whether all the data was copied.
+ */
+bool CopyFd(int from, int to);
+
+} // namespace NCli
@@ -0,0 +1,124 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "io_pump.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace NCli {
+namespace {
+
+void ThrowSystemError() {
+    throw std::system_error(errno, std::system_category());
+}
+
+} // namespace <anonymous>
+
+TIOPump::TIOPump(IIStreamWrapper& in, TPipe& childStdin, TPipe& childStdout, std::ostream& out)
+    : In_(in)
+    , ChildStdin_(childStdin)
+    , ChildStdout_(childStdout)
+    , Out_(out)
+    , InBuffer_(childStdin.Capacity())
+    , OutBuffer_(childStdout.Capacity())
+{}
+
+void TIOPump::Run() {
+    int inFd = ChildStdin_.WriteEndDescriptor();
+    if (fcntl(inFd, F_SETFL, fcntl(inFd, F_GETFL) | O_NONBLOCK) == -1) {
+        ThrowSystemError();
+    }
+
+    bool draining = true;
+    while (draining) {
+        pollfd fds[2];
+        nfds_t count = 0;
+        fds[count++] = {ChildStdout_.ReadEndDescriptor(), POLLIN, 0};
+        if (Feeding_) {
+            fds[count++] = {ChildStdin_.WriteEndDescriptor(), POLLOUT, 0};
+        }
+
+        if (poll(fds, count, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError();
+        }
+
+        if (count == 2 && fds[1].revents != 0 && !Feed()) {
+            FinishFeeding();
+        }
+        if (fds[0].revents != 0) {
+            draining = Drain();
+        }
+    }
+
+    if (Feeding_) {
+        FinishFeeding();
+    }
+}
+
+bool TIOPump::Feed() {
+    while (true) {
+        if (InBegin_ == InEnd_) {
+            InBegin_ = 0;
+            InEnd_ = In_.ReadChunk(InBuffer_.data(), InBuffer_.size());
+            if (InEnd_ == 0) {
+                return false;
+            }
+        }
+
+        ssize_t written = write(ChildStdin_.WriteEndDescriptor(), InBuffer_.data() + InBegin_, InEnd_ - InBegin_);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // EAGAIN means that the pipe is full. Any other error (EPIPE, for example) means that the child is not
+            // going to read the rest of the input.
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        InBegin_ += written;
+    }
+}
+
+bool TIOPump::Drain() {
+    while (true) {
+        ssize_t status = read(ChildStdout_.ReadEndDescriptor(), OutBuffer_.data(), OutBuffer_.size());
+        if (status < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError();
+        }
+        if (status == 0) {
+            return false;
+        }
+        Out_.write(OutBuffer_.data(), status);
+        return true;
+    }
+}
+
+void TIOPump::FinishFeeding() {
+    Feeding_ = false;
+    ChildStdin_.CloseWriteEnd();
+}
+
+} // namespace NCli
@@ -0,0 +1,82 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <common/istream_wrapper.h>
+#include <common/pipe.h>
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace NCli {
+
+/**
+ * Exchanges data with a child process: feeds its stdin and drains its stdout at the same time.
+ *
+ * Writing the whole input first and reading the output afterwards deadlocks as soon as the child writes more than a
+ * pipe buffer before it has read all of its input. The pump waits for both pipes with poll(2) instead and moves the
+ * data in chunks of the pipe capacity in whichever direction is ready. The child should be waited for only after
+ * {@link NCli::TIOPump::Run} returns, which happens once its stdout reaches EOF.
+ */
+class TIOPump final {
+public:
+    /**
+     * Constructs a pump.
+     *
+     * @param in The input wrapper providing the data for the child stdin.
+     * @param childStdin The pipe connected to the child stdin, registered for writing.
+     * @param childStdout The pipe connected to the child stdout, registered for reading.
+     * @param out The stream to which the child output is written.
+     */
+    TIOPump(IIStreamWrapper& in, TPipe& childStdin, TPipe& childStdout, std::ostream& out);
+
+    /**
+     * The pump refers to the pipes and streams it does not own, so it is not copy-constructible nor copy-assignable
+     * nor move-constructible nor move-assignable.
+     */
+    ~TIOPump() = default;
+    TIOPump(const TIOPump&) = delete;
+    TIOPump& operator=(const TIOPump&) = delete;
+    TIOPump(TIOPump&&) = delete;
+    TIOPump& operator=(TIOPump&&) = delete;
+
+    /**
+     * Moves the data until the child stdout is closed. The child stdin is closed as soon as the input is over or the
+     * child stops reading it.
+     */
+    void Run();
+
+private:
+    bool Feed();
+    bool Drain();
+    void FinishFeeding();
+
+    IIStreamWrapper& In_;
+    TPipe& ChildStdin_;
+    TPipe& ChildStdout_;
+    std::ostream& Out_;
+
+    std::vector<char> InBuffer_;
+    std::size_t InBegin_ = 0;
+    std::size_t InEnd_ = 0;
+    bool Feeding_ = true;
+
+    std::vector<char> OutBuffer_;
+};
+
+} // namespace NCli
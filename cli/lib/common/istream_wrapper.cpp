@@ -16,11 +16,10 @@
 
 #include "istream_wrapper.h"
 
+#include <common/fd_stream.h>
+
 #include <algorithm>
 #include <iostream>
-#include <string>
-
-#include <unistd.h>
 
 namespace NCli {
 
@@ -36,26 +35,48 @@ TPipeIStreamWrapper::TPipeIStreamWrapper(std::istream& is)
     : TIStreamWrapperBase(is)
 {}
 
-int TPipeIStreamWrapper::Dup(int fd1, int fd2) {
-    return dup2(fd1, fd2);
+bool TPipeIStreamWrapper::IsPiped() const {
+    return true;
+}
+
+void TPipeIStreamWrapper::CopyContentToFile(int fileDescriptor, std::size_t bufferSize) {
+    Buffer_.resize(bufferSize);
+    std::size_t size;
+    while ((size = ReadChunk(Buffer_.data(), Buffer_.size())) != 0) {
+        if (!WriteAll(fileDescriptor, Buffer_.data(), size)) {
+            // The reader has gone away (EPIPE), so the rest of the input is not needed.
+            break;
+        }
+    }
 }
 
-void TPipeIStreamWrapper::CopyContentToFile(int fileDescriptor) {
-    std::string input;
-    std::copy(std::istreambuf_iterator<char>(WrappedIStream()),
-              std::istreambuf_iterator<char>(),
-              std::back_inserter(input));
-    write(fileDescriptor, input.c_str(), input.size());
+std::size_t TPipeIStreamWrapper::ReadChunk(char* buf, std::size_t size) {
+    // Only the data available at once is taken. The stream buffer is asked for the next character first, which blocks
+    // until there is some data.
+    std::streambuf* streamBuf = WrappedIStream().rdbuf();
+    std::streamsize available = streamBuf->in_avail();
+    if (available <= 0) {
+        if (std::streambuf::traits_type::eq_int_type(streamBuf->sgetc(), std::streambuf::traits_type::eof())) {
+            WrappedIStream().setstate(std::ios::eofbit);
+            return 0;
+        }
+        available = std::max<std::streamsize>(streamBuf->in_avail(), 1);
+    }
+    return streamBuf->sgetn(buf, std::min<std::streamsize>(available, size));
 }
 
 TStdinIStreamWrapper::TStdinIStreamWrapper(std::istream& is)
     : TIStreamWrapperBase(is)
 {}
 
-int TStdinIStreamWrapper::Dup(int, int) {
-    return 0;
+bool TStdinIStreamWrapper::IsPiped() const {
+    return false;
 }
 
-void TStdinIStreamWrapper::CopyContentToFile(int) {}
+void TStdinIStreamWrapper::CopyContentToFile(int, std::size_t) {}
+
+std::size_t TStdinIStreamWrapper::ReadChunk(char*, std::size_t) {
+    return 0;
+}
 
 }
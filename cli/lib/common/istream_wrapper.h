@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iosfwd>
+#include <vector>
 
 namespace NCli {
 
@@ -33,20 +35,33 @@ public:
     virtual ~IIStreamWrapper() = default;
 
     /**
-     * This is called in a child process after fork in order to send pipe input to STDIN.
-     *
-     * @param fd1 File descriptor of a pipe read end.
-     * @param fd2 File descriptor of STDIN.
-     * @return {@see dup(2)}
+     * Returns whether the input must be sent to a child process through a pipe. Otherwise, the child reads the same
+     * stdin as the shell does.
      */
-    virtual int Dup(int fd1, int fd2) = 0;
+    virtual bool IsPiped() const = 0;
 
     /**
      * This is called in a parent process in order to send the whole input through a pipe.
      *
+     * The call blocks until the input is over or the reader closes the pipe, so it must be made on a thread which is
+     * not responsible for reading the output of the same child.
+     *
      * @param fileDescriptor File descriptor of a pipe write end.
+     * @param bufferSize Size of the chunks the input is sent in, normally the capacity of the pipe.
      */
-    virtual void CopyContentToFile(int fileDescriptor) = 0;
+    virtual void CopyContentToFile(int fileDescriptor, std::size_t bufferSize) = 0;
+
+    /**
+     * This is called in a parent process in order to send the input through a pipe chunk by chunk.
+     *
+     * The call returns as soon as some input is available, without waiting for the whole buffer to be filled, so a slow
+     * producer does not hold back the data it has already given.
+     *
+     * @param buf Buffer to store the next chunk of the input.
+     * @param size Size of the buffer.
+     * @return Number of bytes stored to the buffer. Zero means that there is nothing more to send.
+     */
+    virtual std::size_t ReadChunk(char* buf, std::size_t size) = 0;
 
     /**
      * Returns the wrapped input stream.
@@ -89,16 +104,27 @@ public:
     ~TPipeIStreamWrapper() override = default;
 
     /**
-     * {@link NCli::IIStreamWrapper::Dup}
+     * Actually, returns true.
      */
-    int Dup(int fd1, int fd2) override;
+    bool IsPiped() const override;
 
     /**
      * {@link NCli::IIStreamWrapper::CopyContentToFile}
+     *
+     * The input is copied in chunks through a single reusable buffer, so the memory usage does not depend on the input
+     * size. Partial writes are retried until the whole chunk is written.
      */
-    void CopyContentToFile(int fileDescriptor) override;
+    void CopyContentToFile(int fileDescriptor, std::size_t bufferSize) override;
+
+    /**
+     * {@link NCli::IIStreamWrapper::ReadChunk}
+     */
+    std::size_t ReadChunk(char* buf, std::size_t size) override;
 
     using TIStreamWrapperBase::WrappedIStream;
+
+private:
+    std::vector<char> Buffer_;
 };
 
 /**
@@ -111,14 +137,19 @@ public:
     ~TStdinIStreamWrapper() override = default;
 
     /**
-     * Actually, does nothing.
+     * Actually, returns false.
      */
-    int Dup(int fd1, int fd2) override;
+    bool IsPiped() const override;
 
     /**
      * Actually, does nothing.
      */
-    void CopyContentToFile(int fileDescriptor) override;
+    void CopyContentToFile(int fileDescriptor, std::size_t bufferSize) override;
+
+    /**
+     * Actually, does nothing: the child reads stdin by itself.
+     */
+    std::size_t ReadChunk(char* buf, std::size_t size) override;
 
     using TIStreamWrapperBase::WrappedIStream;
 };
@@ -0,0 +1,142 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace NCli {
+
+/**
+ * Returns the number of jobs run at once by default: the number of hardware threads, at least one.
+ */
+std::size_t DefaultJobs();
+
+/**
+ * Computes {@arg count} results by calling {@arg compute} with their indices on at most {@arg jobs} threads, and
+ * passes every result to {@arg emit} with its index on the calling thread, in the order of the indices.
+ *
+ * A result is emitted as soon as it and all the previous ones are computed. Only a few results per thread are computed
+ * ahead of the emitted ones, so the memory taken by the results does not grow with their number. An exception thrown
+ * by {@arg compute} is rethrown in place of emitting the result; an exception thrown by {@arg compute} or
+ * {@arg emit} stops the computation of the rest of the results.
+ *
+ * With a single job, everything is done on the calling thread.
+ */
+template <typename TCompute, typename TEmit>
+void ForEachOrdered(std::size_t count, std::size_t jobs, TCompute&& compute, TEmit&& emit) {
+    using TResult = decltype(compute(std::size_t()));
+
+    jobs = std::min(jobs, count);
+    if (jobs <= 1) {
+        for (std::size_t i = 0; i != count; i++) {
+            emit(i, compute(i));
+        }
+        return;
+    }
+
+    struct TSlot {
+        std::optional<TResult> Result;
+        std::exception_ptr Error;
+        bool Ready = false;
+    };
+    std::vector<TSlot> slots(count);
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t next = 0;
+    std::size_t emitted = 0;
+    bool stop = false;
+    const std::size_t window = jobs * 4;
+
+    auto work = [&]() {
+        while (true) {
+            std::size_t i;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() {
+                    return stop || next == count || next < emitted + window;
+                });
+                if (stop || next == count) {
+                    return;
+                }
+                i = next++;
+            }
+
+            TSlot slot;
+            try {
+                slot.Result.emplace(compute(i));
+            } catch (...) {
+                slot.Error = std::current_exception();
+            }
+            slot.Ready = true;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slots[i] = std::move(slot);
+            }
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(jobs);
+    for (std::size_t j = 0; j != jobs; j++) {
+        threads.emplace_back(work);
+    }
+
+    std::exception_ptr error;
+    try {
+        for (std::size_t i = 0; i != count; i++) {
+            TSlot slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() {
+                    return slots[i].Ready;
+                });
+                slot = std::move(slots[i]);
+                emitted = i + 1;
+            }
+            changed.notify_all();
+            if (slot.Error) {
+                std::rethrow_exception(slot.Error);
+            }
+            emit(i, std::move(slot.Result.value()));
+        }
+    } catch (...) {
+        error = std::current_exception();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace NCli
@@ -16,24 +16,58 @@
 
 #include "pipe.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <fstream>
+#include <mutex>
 #include <stdexcept>
+#include <system_error>
 
 #include <unistd.h>
 
 namespace NCli {
+namespace {
 
-TPipe::TPipe() {
+std::mutex BrokenPipeSignalMutex;
+std::size_t BrokenPipeSignalGuards = 0;
+void (*PreviousBrokenPipeHandler)(int) = SIG_DFL;
+
+} // namespace <anonymous>
+
+TPipe::TPipe(int flags) {
     Direction_ = EDirection::UNSPECIFIED;
-    pipe(FD_);
+    if (pipe2(FD_, flags) == -1) {
+        Status_[0] = EPipeEndStatus::CLOSED;
+        Status_[1] = EPipeEndStatus::CLOSED;
+        throw std::system_error(errno, std::system_category(), "pipe");
+    }
 }
 
 TPipe::~TPipe() {
-    if (Status_[0] == EPipeEndStatus::OPEN) {
-        close(FD_[0]);
-    }
-    if (Status_[1] == EPipeEndStatus::OPEN) {
-        close(FD_[1]);
+    Close();
+}
+
+TPipe::TPipe(TPipe&& other) noexcept
+    : FD_{other.FD_[0], other.FD_[1]}
+    , Status_{other.Status_[0], other.Status_[1]}
+    , Direction_(other.Direction_)
+{
+    other.Status_[0] = EPipeEndStatus::CLOSED;
+    other.Status_[1] = EPipeEndStatus::CLOSED;
+}
+
+TPipe& TPipe::operator=(TPipe&& other) noexcept {
+    if (this != &other) {
+        Close();
+        for (int i = 0; i != 2; i++) {
+            FD_[i] = other.FD_[i];
+            Status_[i] = other.Status_[i];
+            other.Status_[i] = EPipeEndStatus::CLOSED;
+        }
+        Direction_ = other.Direction_;
     }
+    return *this;
 }
 
 void TPipe::RegisterDirection(TPipe::EDirection direction) {
@@ -52,7 +86,7 @@ void TPipe::RegisterDirection(TPipe::EDirection direction) {
 }
 
 int TPipe::ReadEndDescriptor() const {
-    if (Direction_ != EDirection::IN) {
+    if (Direction_ == EDirection::OUT || Status_[0] == EPipeEndStatus::CLOSED) {
         throw std::logic_error("invalid pipe state");
     }
 
@@ -60,7 +94,7 @@ int TPipe::ReadEndDescriptor() const {
 }
 
 int TPipe::WriteEndDescriptor() const {
-    if (Direction_ != EDirection::OUT) {
+    if (Direction_ == EDirection::IN || Status_[1] == EPipeEndStatus::CLOSED) {
         throw std::logic_error("invalid pipe state");
     }
 
@@ -68,7 +102,7 @@ int TPipe::WriteEndDescriptor() const {
 }
 
 void TPipe::CloseWriteEnd() {
-    if (Direction_ != EDirection::OUT) {
+    if (Direction_ != EDirection::OUT && Direction_ != EDirection::BOTH) {
         throw std::logic_error("invalid pipe state");
     }
     if (Status_[1] == EPipeEndStatus::CLOSED) {
@@ -79,4 +113,87 @@ void TPipe::CloseWriteEnd() {
     Status_[1] = EPipeEndStatus::CLOSED;
 }
 
+void TPipe::CloseReadEnd() {
+    if (Direction_ != EDirection::IN && Direction_ != EDirection::BOTH) {
+        throw std::logic_error("invalid pipe state");
+    }
+    if (Status_[0] == EPipeEndStatus::CLOSED) {
+        throw std::logic_error("invalid pipe end status");
+    }
+
+    close(ReadEndDescriptor());
+    Status_[0] = EPipeEndStatus::CLOSED;
+}
+
+void TPipe::Close() {
+    for (int i = 0; i != 2; i++) {
+        if (Status_[i] == EPipeEndStatus::OPEN) {
+            close(FD_[i]);
+            Status_[i] = EPipeEndStatus::CLOSED;
+        }
+    }
+}
+
+std::vector<int> TPipe::OpenDescriptors() const {
+    std::vector<int> ret;
+    for (int i = 0; i != 2; i++) {
+        if (Status_[i] == EPipeEndStatus::OPEN) {
+            ret.push_back(FD_[i]);
+        }
+    }
+    return ret;
+}
+
+std::size_t TPipe::SetCapacity(std::size_t capacity) {
+    int fd = Status_[0] == EPipeEndStatus::OPEN ? FD_[0] : FD_[1];
+    std::size_t size = std::min(capacity, MaxCapacity());
+    if (size > Capacity()) {
+        fcntl(fd, F_SETPIPE_SZ, static_cast<int>(size));
+    }
+    return Capacity();
+}
+
+std::size_t TPipe::Capacity() const {
+    if (Status_[0] == EPipeEndStatus::CLOSED && Status_[1] == EPipeEndStatus::CLOSED) {
+        throw std::logic_error("invalid pipe end status");
+    }
+    return CapacityOf(Status_[0] == EPipeEndStatus::OPEN ? FD_[0] : FD_[1]);
+}
+
+std::size_t TPipe::CapacityOf(int fd) {
+    int size = fcntl(fd, F_GETPIPE_SZ);
+    return size > 0 ? size : 0;
+}
+
+std::size_t TPipe::MaxCapacity() {
+    static const std::size_t maxCapacity = []() -> std::size_t {
+        std::ifstream in("/proc/sys/fs/pipe-max-size");
+        std::size_t size = 0;
+        if (in >> size && size != 0) {
+            return size;
+        }
+        // The default limit of Linux.
+        return 1 << 20;
+    }();
+    return maxCapacity;
+}
+
+TBrokenPipeSignalGuard::TBrokenPipeSignalGuard() {
+    std::lock_guard<std::mutex> lock(BrokenPipeSignalMutex);
+    if (BrokenPipeSignalGuards++ == 0) {
+        PreviousBrokenPipeHandler = std::signal(SIGPIPE, SIG_IGN);
+    }
+}
+
+TBrokenPipeSignalGuard::~TBrokenPipeSignalGuard() {
+    std::lock_guard<std::mutex> lock(BrokenPipeSignalMutex);
+    if (--BrokenPipeSignalGuards == 0 && PreviousBrokenPipeHandler != SIG_ERR) {
+        std::signal(SIGPIPE, PreviousBrokenPipeHandler);
+    }
+}
+
+void RestoreBrokenPipeSignal() {
+    std::signal(SIGPIPE, SIG_DFL);
+}
+
 } // namespace NCli
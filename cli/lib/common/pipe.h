@@ -16,6 +16,11 @@
 
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
+#include <fcntl.h>
+
 namespace NCli {
 
 /**
@@ -44,11 +49,13 @@ namespace NCli {
 class TPipe final {
 public:
     /**
-     * Opens a new pipe.
+     * Opens a new pipe with the {@arg flags} of pipe2(2). The descriptors are closed on exec by default: the children
+     * get the pipes they need as their standard streams only.
      *
+     * @throws std::system_error if the pipe cannot be opened.
      * @see pipe(2)
      */
-    TPipe();
+    explicit TPipe(int flags = O_CLOEXEC);
 
     /**
      * Closes the opened descriptors.
@@ -65,10 +72,10 @@ public:
     /**
      * This class is move-constructible and move-assignable. Calling any of this delegates the responsibility to close
      * the file descriptors to a new object (in case of move constructor) or to the left operand (in case of move
-     * assignment operator).
+     * assignment operator). The moved-from pipe is left with both ends closed.
      */
-    TPipe(TPipe&&) noexcept = default;
-    TPipe& operator=(TPipe&&) noexcept = default;
+    TPipe(TPipe&& other) noexcept;
+    TPipe& operator=(TPipe&& other) noexcept;
 
     /**
      * Represents the direction in which the pipe is used in the current process.
@@ -87,7 +94,13 @@ public:
         /**
          * This process writes to the pipe.
          */
-        OUT
+        OUT,
+
+        /**
+         * This process both reads from and writes to the pipe, for example, from different threads. Each end must
+         * be used and closed by a single thread.
+         */
+        BOTH
     };
 
     /**
@@ -96,14 +109,15 @@ public:
      * This also closes the unused file descriptor, as it is recommended by the manual page {@see pipe(2)}.
      *
      * This method **must** be called **once in each process** with different arguments. Attempt to call it twice from
-     * the same process will cause a std::logic_error.
+     * the same process will cause a std::logic_error. Registering EDirection::BOTH closes nothing.
      */
     void RegisterDirection(EDirection direction);
 
     /**
      * Returns the descriptor of the read end of the pipe.
      *
-     * Attempt to call it in case of unregistered or registered write direction will cause a std::logic_error.
+     * Attempt to call it in case of registered write direction or closed read end will cause a std::logic_error. An
+     * unregistered pipe has both ends open, so this is allowed before forking, for example, to set up redirections.
      * Note that it is NCli::TPipe responsibility to close the file descriptors. Attempt to close it manually will
      * result in double-closing of descriptor, which is an error with errno in case the descriptor was not reused or
      * closing an unrelated file in case it was.
@@ -113,7 +127,8 @@ public:
     /**
      * Returns the descriptor of the write end of the pipe.
      *
-     * Attempt to call if in case of unregistered or registered read direction will cause a std::logic_error.
+     * Attempt to call it in case of registered read direction or closed write end will cause a std::logic_error. An
+     * unregistered pipe has both ends open, so this is allowed before forking, for example, to set up redirections.
      * Note that it is NCli::TPipe responsibility to close the file descriptors. Attempt to close it manually will
      * result in double-closing of descriptor, which is an error with errno in case the descriptor was not reused or
      * closing an unrelated file in case it was.
@@ -127,6 +142,53 @@ public:
      */
     void CloseWriteEnd();
 
+    /**
+     * Closes the read end of the pipe.
+     *
+     * As the result, writes to the pipe will fail with EPIPE.
+     */
+    void CloseReadEnd();
+
+    /**
+     * Closes every end of the pipe which is still open in this process, regardless of the registered direction.
+     *
+     * This is used by the processes which are not supposed to use the pipe at all, for example, by the stages of a
+     * pipeline which are not connected to it. Otherwise the reader would never reach EOF.
+     */
+    void Close();
+
+    /**
+     * Returns the descriptors of the ends which are still open in this process.
+     */
+    std::vector<int> OpenDescriptors() const;
+
+    /**
+     * Asks the kernel to make the pipe hold at least {@arg capacity} bytes, but no more than
+     * {@link NCli::TPipe::MaxCapacity}. The kernel rounds the capacity up to a power of two pages. The capacity is left
+     * as it is if it cannot be changed, for example, when the user already has too many large pipes.
+     *
+     * @return The effective capacity.
+     * @see fcntl(2), F_SETPIPE_SZ
+     */
+    std::size_t SetCapacity(std::size_t capacity);
+
+    /**
+     * Returns the number of bytes the pipe holds before a write to it blocks.
+     *
+     * Attempt to call it when both ends are closed in this process will cause a std::logic_error.
+     */
+    std::size_t Capacity() const;
+
+    /**
+     * Returns the capacity of the pipe {@arg fd} is an end of, or zero if it is not a pipe.
+     */
+    static std::size_t CapacityOf(int fd);
+
+    /**
+     * Returns the largest capacity an unprivileged process may set, as given by /proc/sys/fs/pipe-max-size.
+     */
+    static std::size_t MaxCapacity();
+
 private:
     enum class EPipeEndStatus {
         OPEN,
@@ -138,4 +200,33 @@ private:
     EDirection Direction_;
 };
 
+/**
+ * Makes writes to a pipe without readers fail with EPIPE instead of killing the current process with SIGPIPE while the
+ * object exists.
+ *
+ * The shell itself writes to pipes read by the stages of a pipeline, any of which may exit without reading its input.
+ * The disposition is process-wide, so the guards existing at the same time share it: the first one ignores the signal
+ * and the last one restores the disposition it has found.
+ */
+class TBrokenPipeSignalGuard final {
+public:
+    TBrokenPipeSignalGuard();
+    ~TBrokenPipeSignalGuard();
+
+    /**
+     * The guard is bound to a scope, so it is not copy-constructible nor copy-assignable nor move-constructible nor
+     * move-assignable.
+     */
+    TBrokenPipeSignalGuard(const TBrokenPipeSignalGuard&) = delete;
+    TBrokenPipeSignalGuard& operator=(const TBrokenPipeSignalGuard&) = delete;
+    TBrokenPipeSignalGuard(TBrokenPipeSignalGuard&&) = delete;
+    TBrokenPipeSignalGuard& operator=(TBrokenPipeSignalGuard&&) = delete;
+};
+
+/**
+ * Restores the default SIGPIPE disposition. This is called in child processes, because the ignored disposition is
+ * inherited through execve(2).
+ */
+void RestoreBrokenPipeSignal();
+
 } // namespace NCli
@@ -18,8 +18,6 @@
 
 #include <common/char_utils.h>
 
-#include <algorithm>
-#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -69,39 +67,217 @@ std::optional<TAssignment> ParseEnvVarAssignment(const std::string& s) {
     return ret;
 }
 
+TEnvironment::TEnvironment(const TEnvironment& other)
+    : Table_(other.Table_)
+{}
+
+TEnvironment& TEnvironment::operator=(const TEnvironment& other) {
+    if (this == &other) {
+        return *this;
+    }
+    Table_ = other.Table_;
+    Slots_.clear();
+    Marked_.clear();
+    Dirty_.clear();
+    Image_.clear();
+    Pointers_.assign(1, nullptr);
+    return *this;
+}
+
+std::string& TEnvironment::operator[](const std::string& name) {
+    Detach();
+    std::size_t hash = NPrivate::TVariableTable::Hash(name);
+    std::size_t index = Table_->Find(name, hash);
+    if (index == NO_INDEX) {
+        index = Table_->Insert(name, hash);
+    }
+    MarkDirty(index);
+    return (*Table_)[index].Value;
+}
+
+const std::string* TEnvironment::Find(std::string_view name) const {
+    std::size_t index = FindIndex(name, NPrivate::TVariableTable::Hash(name));
+    return index != NO_INDEX ? &(*Table_)[index].Value : nullptr;
+}
+
+const std::string* TEnvironment::Find(std::string_view name, std::size_t hash) const {
+    std::size_t index = FindIndex(name, hash);
+    return index != NO_INDEX ? &(*Table_)[index].Value : nullptr;
+}
+
+const std::string& TEnvironment::GetValue(std::string_view name) const {
+    static const std::string empty;
+    const std::string* value = Find(name);
+    return value != nullptr ? *value : empty;
+}
+
+bool TEnvironment::Empty() const {
+    return Size() == 0;
+}
+
+std::size_t TEnvironment::Size() const {
+    return Table_ ? Table_->Size() : 0;
+}
+
+bool TEnvironment::operator==(const TEnvironment& other) const {
+    if (Table_ == other.Table_) {
+        return true;
+    }
+    if (Size() != other.Size()) {
+        return false;
+    }
+    if (Empty()) {
+        return true;
+    }
+    for (const auto& variable : *Table_) {
+        std::size_t index = other.FindIndex(variable.Name, variable.Hash);
+        if (index == NO_INDEX || (*other.Table_)[index].Value != variable.Value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TEnvironment::operator!=(const TEnvironment& other) const {
+    return !(*this == other);
+}
+
+char* const* TEnvironment::EnvP() {
+    Sync();
+    return Pointers_.data();
+}
+
+std::size_t TEnvironment::FindIndex(std::string_view name, std::size_t hash) const {
+    return Table_ ? Table_->Find(name, hash) : NO_INDEX;
+}
+
+void TEnvironment::Detach() {
+    if (!Table_) {
+        Table_ = std::make_shared<NPrivate::TVariableTable>();
+    } else if (Table_.use_count() > 1) {
+        // The indices are kept by the copy, so the image stays valid.
+        Table_ = std::make_shared<NPrivate::TVariableTable>(*Table_);
+    }
+}
+
+void TEnvironment::MarkDirty(std::size_t index) {
+    // The variables which are not rendered yet are all rendered by the next synchronization anyway.
+    if (index < Slots_.size() && !Marked_[index]) {
+        Marked_[index] = true;
+        Dirty_.push_back(index);
+    }
+}
+
+void TEnvironment::Sync() {
+    auto render = [](const NPrivate::TVariableTable::TVariable& variable) {
+        std::string rendered;
+        rendered.reserve(variable.Name.size() + 1 + variable.Value.size());
+        rendered.append(variable.Name).append(1, '=').append(variable.Value);
+        return rendered;
+    };
+
+    for (std::size_t index : Dirty_) {
+        std::size_t slot = Slots_[index];
+        Image_[slot] = render((*Table_)[index]);
+        Pointers_[slot] = Image_[slot].data();
+        Marked_[index] = false;
+    }
+    Dirty_.clear();
+
+    for (std::size_t index = Slots_.size(); index != Size(); index++) {
+        // std::deque never moves its elements on push_back, so the other pointers stay valid.
+        Slots_.push_back(Image_.size());
+        Marked_.push_back(false);
+        Image_.push_back(render((*Table_)[index]));
+        Pointers_.back() = Image_.back().data();
+        Pointers_.push_back(nullptr);
+    }
+}
+
 TCmdEnvironment::TCmdEnvironment(TEnvironment& globalEnvironment)
     : GlobalEnvironment_(globalEnvironment)
 {}
 
-const std::string& TCmdEnvironment::GetValue(const std::string& name) const {
-    if (LocalEnvironment_.count(name)) {
-        return LocalEnvironment_.at(name);
+const std::string& TCmdEnvironment::GetValue(std::string_view name) const {
+    static const std::string empty;
+    std::size_t hash = NPrivate::TVariableTable::Hash(name);
+    std::size_t index = LocalEnvironment_.Find(name, hash);
+    if (index != NPrivate::TVariableTable::NPOS) {
+        return LocalEnvironment_[index].Value;
     }
-    if (GlobalEnvironment_.count(name)) {
-        return GlobalEnvironment_[name];
+    index = GlobalEnvironment_.FindIndex(name, hash);
+    if (index != TEnvironment::NO_INDEX) {
+        return (*GlobalEnvironment_.Table_)[index].Value;
     }
-    return EmptyString_;
+    return empty;
+}
+
+bool TCmdEnvironment::IsLocal(std::string_view name) const {
+    return LocalEnvironment_.Find(name, NPrivate::TVariableTable::Hash(name)) != NPrivate::TVariableTable::NPOS;
 }
 
 void TCmdEnvironment::SetLocalValue(const std::string& name, const std::string& value) {
-    LocalEnvironment_[name] = value;
+    std::size_t hash = NPrivate::TVariableTable::Hash(name);
+    std::size_t index = LocalEnvironment_.Find(name, hash);
+    if (index == NPrivate::TVariableTable::NPOS) {
+        index = LocalEnvironment_.Insert(name, hash);
+    }
+    LocalEnvironment_[index].Value = value;
 }
 
 std::vector<std::string> TCmdEnvironment::ToEnvP() const {
     std::vector<std::string> ret;
-    for (auto p : GlobalEnvironment_) {
-        if (!LocalEnvironment_.count(p.first)) {
-            char buf[p.first.size() + 1 + p.second.size() + 1];
-            std::sprintf(buf, "%s=%s", p.first.c_str(), p.second.c_str());
-            ret.push_back(buf);
+    if (GlobalEnvironment_.Table_) {
+        for (const auto& variable : *GlobalEnvironment_.Table_) {
+            if (LocalEnvironment_.Find(variable.Name, variable.Hash) == NPrivate::TVariableTable::NPOS) {
+                ret.push_back(variable.Name + "=" + variable.Value);
+            }
         }
     }
-    for (auto p : LocalEnvironment_) {
-        char buf[p.first.size() + 1 + p.second.size() + 1];
-        std::sprintf(buf, "%s=%s", p.first.c_str(), p.second.c_str());
-        ret.push_back(buf);
+    for (const auto& variable : LocalEnvironment_) {
+        ret.push_back(variable.Name + "=" + variable.Value);
     }
     return ret;
 }
 
+TCmdEnvironment::TEnvP TCmdEnvironment::EnvP() {
+    return TEnvP(GlobalEnvironment_, LocalEnvironment_);
+}
+
+TCmdEnvironment::TEnvP::TEnvP(TEnvironment& global, const NPrivate::TVariableTable& local)
+    : Global_(global)
+{
+    Global_.Sync();
+
+    // The strings must not be reallocated once their pointers are taken.
+    Strings_.reserve(local.Size());
+    for (const auto& variable : local) {
+        Strings_.push_back(variable.Name + "=" + variable.Value);
+        char* string = Strings_.back().data();
+
+        std::size_t index = Global_.FindIndex(variable.Name, variable.Hash);
+        if (index != TEnvironment::NO_INDEX) {
+            std::size_t slot = Global_.Slots_[index];
+            Replaced_.emplace_back(slot, Global_.Pointers_[slot]);
+            Global_.Pointers_[slot] = string;
+        } else {
+            Global_.Pointers_.back() = string;
+            Global_.Pointers_.push_back(nullptr);
+            Appended_++;
+        }
+    }
+}
+
+TCmdEnvironment::TEnvP::~TEnvP() {
+    Global_.Pointers_.resize(Global_.Pointers_.size() - Appended_);
+    Global_.Pointers_.back() = nullptr;
+    for (const auto& [slot, pointer] : Replaced_) {
+        Global_.Pointers_[slot] = pointer;
+    }
+}
+
+char* const* TCmdEnvironment::TEnvP::Get() const {
+    return Global_.Pointers_.data();
+}
+
 } // namespace NCli
\ No newline at end of file
@@ -16,9 +16,15 @@
 
 #pragma once
 
-#include <map>
+#include <environment/variable_table.h>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace NCli {
@@ -50,9 +56,103 @@ std::optional<TAssignment> ParseEnvVarAssignment(const std::string& s);
 /**
  * This type represents the environment, global or local.
  *
- * The environment is understood as a dictionary from variable name to its value.
+ * The environment is understood as a dictionary from variable name to its value. The variables are stored in a
+ * {@link NCli::NPrivate::TVariableTable}, so a lookup hashes the name once and usually compares it with a single
+ * variable. Looking up a missing variable never changes the environment.
+ *
+ * The table is shared between copies of the environment and copied on the first change made through one of them, so a
+ * snapshot of the environment (for a pipeline stage, a subshell and so on) takes constant time.
+ *
+ * Besides the dictionary, the environment keeps its image in the format taken by execve(2): an array of "NAME=value"
+ * strings. The image is kept in sync incrementally: an assignment only marks the variable, and the next request for
+ * the image renders the marked variables again, so launching a process does not walk the whole environment. The image
+ * is not shared, a copy renders its own one when it is requested for the first time.
  */
-using TEnvironment = std::map<std::string, std::string>;
+class TEnvironment final {
+public:
+    /**
+     * Constructs an empty environment.
+     */
+    TEnvironment() = default;
+
+    /**
+     * Copying the environment shares the variables with the original and takes constant time. It is
+     * move-constructible and move-assignable as well.
+     */
+    ~TEnvironment() = default;
+    TEnvironment(const TEnvironment& other);
+    TEnvironment& operator=(const TEnvironment& other);
+    TEnvironment(TEnvironment&&) noexcept = default;
+    TEnvironment& operator=(TEnvironment&&) noexcept = default;
+
+    /**
+     * Returns a reference to the value of a variable, creating an empty one if there is no such variable.
+     *
+     * As the value may be changed through the reference, the variable is rendered into the image again the next time
+     * it is requested. The reference must not be used after the environment is copied.
+     */
+    std::string& operator[](const std::string& name);
+
+    /**
+     * Returns the pointer to the value of a variable, or nullptr if there is no such variable.
+     */
+    const std::string* Find(std::string_view name) const;
+
+    /**
+     * The same as the other overload, but takes the hash of the name computed by
+     * {@link NCli::NPrivate::TVariableTable::Hash} in advance.
+     */
+    const std::string* Find(std::string_view name, std::size_t hash) const;
+
+    /**
+     * Returns the value of a variable, or an empty string if there is no such variable.
+     */
+    const std::string& GetValue(std::string_view name) const;
+
+    /**
+     * Returns whether there are no variables.
+     */
+    bool Empty() const;
+
+    /**
+     * Returns the number of variables.
+     */
+    std::size_t Size() const;
+
+    /**
+     * Compares the variables and their values.
+     */
+    bool operator==(const TEnvironment& other) const;
+    bool operator!=(const TEnvironment& other) const;
+
+    /**
+     * Returns the null-terminated image of the environment in the format taken by execve(2).
+     *
+     * The pointers stay valid until the next change of the environment.
+     */
+    char* const* EnvP();
+
+private:
+    static constexpr std::size_t NO_INDEX = NPrivate::TVariableTable::NPOS;
+
+    std::size_t FindIndex(std::string_view name, std::size_t hash) const;
+    void Detach();
+    void MarkDirty(std::size_t index);
+    void Sync();
+
+    std::shared_ptr<NPrivate::TVariableTable> Table_;
+
+    /**
+     * The image: the slot of each rendered variable, indexed like the table, and the rendered variables changed since.
+     */
+    std::vector<std::size_t> Slots_;
+    std::vector<bool> Marked_;
+    std::vector<std::size_t> Dirty_;
+    std::deque<std::string> Image_;
+    std::vector<char*> Pointers_{nullptr};
+
+    friend class TCmdEnvironment;
+};
 
 /**
  * Parses the global environment (usually the third optional argument to main function) and returns its representation
@@ -65,6 +165,9 @@ TEnvironment LoadGlobalEnvironment(const char **envp);
 /**
  * Represents an enviroment specific to a particular command. Stores a pair of reference to global environment and a
  * local environment.
+ *
+ * The local environment is a layer above the global one: a lookup hashes the name once and probes the local table,
+ * then the global one, with the same hash.
  */
 class TCmdEnvironment final {
 public:
@@ -88,7 +191,12 @@ public:
      *
      * Looks up its value in local environments, then, if no such variable found, in global environment.
      */
-    const std::string& GetValue(const std::string& name) const;
+    const std::string& GetValue(std::string_view name) const;
+
+    /**
+     * Returns whether the variable is assigned in the local environment.
+     */
+    bool IsLocal(std::string_view name) const;
 
     /**
      * Sets the variable value in the local environment. Does not affect the global environment.
@@ -100,10 +208,48 @@ public:
      */
     std::vector<std::string> ToEnvP() const;
 
+    /**
+     * The image of the command environment in the format taken by execve(2).
+     *
+     * It is the image of the global environment with the pointers of the locally assigned variables temporarily
+     * replaced or appended, so it takes time proportional to the number of local assignments. The global image is
+     * restored when the object is destroyed, so only one such object may exist for a global environment at a time,
+     * and the global environment must not be changed while it exists.
+     */
+    class TEnvP final {
+    public:
+        ~TEnvP();
+        TEnvP(const TEnvP&) = delete;
+        TEnvP& operator=(const TEnvP&) = delete;
+        TEnvP(TEnvP&&) noexcept = delete;
+        TEnvP& operator=(TEnvP&&) noexcept = delete;
+
+        /**
+         * Returns the null-terminated array of "NAME=value" strings.
+         */
+        char* const* Get() const;
+
+    private:
+        TEnvP(TEnvironment& global, const NPrivate::TVariableTable& local);
+
+        TEnvironment& Global_;
+        std::vector<std::string> Strings_;
+        std::vector<std::pair<std::size_t, char*>> Replaced_;
+        std::size_t Appended_ = 0;
+
+        friend class TCmdEnvironment;
+    };
+
+    /**
+     * Returns the image of the command environment.
+     *
+     * @see NCli::TCmdEnvironment::TEnvP
+     */
+    TEnvP EnvP();
+
 private:
     TEnvironment& GlobalEnvironment_;
-    TEnvironment LocalEnvironment_;
-    std::string EmptyString_;
+    NPrivate::TVariableTable LocalEnvironment_;
 };
 
 } // namespace NCli
@@ -19,6 +19,8 @@
 #include <common/char_utils.h>
 
 #include <cctype>
+#include <string_view>
+#include <utility>
 
 namespace NCli {
 namespace {
@@ -40,55 +42,104 @@ enum class EState {
     VARIABLE
 };
 
-TToken DoExpand(TEnvironment& env, const TToken& token) {
-    TToken res;
-    std::string var;
+bool HasVariables(const TToken& token) {
+    return token.Bytes().find('$') != std::string_view::npos;
+}
+
+} // namespace <anonymous>
+
+TVarExpander::TVarExpander(TEnvironment& environment)
+    : Environment_(environment)
+{}
+
+std::vector<TToken> TVarExpander::Expand(const std::vector<TToken>& tokens) {
+    return Expand(std::vector<TToken>(tokens));
+}
+
+std::vector<TToken> TVarExpander::Expand(std::vector<TToken>&& tokens) {
+    for (auto& token : tokens) {
+        if (HasVariables(token)) {
+            const auto& [source, compiled] = FindTemplate(token);
+            if (compiled.Parts.size() > 1) {
+                token = Splice(source, compiled);
+            }
+        }
+    }
+    return std::move(tokens);
+}
+
+std::size_t TVarExpander::TTokenHash::operator()(const TToken& token) const {
+    return token.Hash();
+}
+
+TVarExpander::TTemplate TVarExpander::Compile(const TToken& token) {
+    std::string_view bytes = token.Bytes();
+
+    TTemplate ret;
+    TTemplate::TPart part;
     EState state = EState::NOTHING;
-    for (std::size_t i = 0; i != token.Size(); i++) {
-        const auto& c = token[i];
+    for (std::size_t i = bytes.find('$'); i < bytes.size(); i++) {
         if (state == EState::NOTHING) {
-            if (IsVariableIndicator(c)) {
-                var.clear();
+            i = bytes.find('$', i);
+            if (i == std::string_view::npos) {
+                break;
+            }
+            if (IsVariableIndicator(token[i])) {
+                part.To = i;
                 state = EState::VARIABLE;
-            } else {
-                res.PushBack(c);
             }
         } else {
+            TExtChar c = token[i];
             if (IsVariableNameSymbol(c)) {
-                var.push_back(c.ToChar());
-            } else {
-                for (char x: env[var]) {
-                    res.PushBack(TExtChar(x));
-                }
-                if (IsVariableIndicator(c)) {
-                    var.clear();
-                } else {
-                    state = EState::NOTHING;
-                    res.PushBack(c);
-                }
+                part.Name.push_back(c.ToChar());
+                continue;
+            }
+            part.Hash = NPrivate::TVariableTable::Hash(part.Name);
+            ret.Parts.push_back(std::move(part));
+            part = TTemplate::TPart{i, i, std::string(), 0};
+            if (IsVariableIndicator(c)) {
+                continue;
             }
+            state = EState::NOTHING;
+            i--;
         }
     }
     if (state == EState::VARIABLE) {
-        for (char x: env[var]) {
-            res.PushBack(TExtChar(x));
-        }
+        part.Hash = NPrivate::TVariableTable::Hash(part.Name);
+        ret.Parts.push_back(std::move(part));
+        part = TTemplate::TPart{bytes.size(), bytes.size(), std::string(), 0};
+    } else {
+        part.To = bytes.size();
     }
-    return res;
+    ret.Parts.push_back(std::move(part));
+    return ret;
 }
 
-} // namespace <anonymous>
-
-TVarExpander::TVarExpander(TEnvironment& environment)
-    : Environment_(environment)
-{}
+TToken TVarExpander::Splice(const TToken& token, const TTemplate& compiled) const {
+    TToken ret;
+    for (std::size_t i = 0; i != compiled.Parts.size(); i++) {
+        const TTemplate::TPart& part = compiled.Parts[i];
+        ret.Append(token, part.From, part.To);
+        if (i + 1 == compiled.Parts.size()) {
+            break;
+        }
+        const std::string* value = Environment_.Find(part.Name, part.Hash);
+        if (value != nullptr) {
+            ret.Append(value->data(), value->size());
+        }
+    }
+    return ret;
+}
 
-std::vector<TToken> TVarExpander::Expand(const std::vector<TToken>& tokens) {
-    std::vector<TToken> result;
-    for (const auto& token : tokens) {
-        result.push_back(DoExpand(Environment_, token));
+const TVarExpander::TTemplates::value_type& TVarExpander::FindTemplate(const TToken& token) {
+    auto it = Templates_.find(token);
+    if (it == Templates_.end()) {
+        if (Templates_.size() >= MAX_TEMPLATES) {
+            Templates_.clear();
+        }
+        it = Templates_.emplace(token, Compile(token)).first;
     }
-    return result;
+    return *it;
 }
 
 } // namespace NCli
@@ -19,12 +19,21 @@
 #include <environment/environment.h>
 #include <tokenizer/token.h>
 
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace NCli {
 
 /**
  * Substitutes the environmental variable references by its values in the command.
  *
  * The values are placed in the tokens as extended chars with default escape and ignorance statuses.
+ *
+ * A token referring to variables is compiled into a template once: the runs of its characters to be copied and the
+ * names of the variables between them, with their hashes. The templates are kept for the following lines, so a
+ * repeated command line is expanded by splicing the current values into the copied runs without scanning it again.
  */
 class TVarExpander {
 public:
@@ -47,8 +56,45 @@ public:
      * Performs the actual substitution.
      */
     std::vector<TToken> Expand(const std::vector<TToken>& tokens);
+
+    /**
+     * Performs the actual substitution in place: only the tokens referring to variables are rebuilt, the others are
+     * moved to the result as they are.
+     */
+    std::vector<TToken> Expand(std::vector<TToken>&& tokens);
 private:
+    /**
+     * A compiled token: each part is a run [From, To) of the token characters, followed by a variable reference
+     * unless it is the last part.
+     */
+    struct TTemplate {
+        struct TPart {
+            std::size_t From = 0;
+            std::size_t To = 0;
+            std::string Name;
+            std::size_t Hash = 0;
+        };
+
+        std::vector<TPart> Parts;
+    };
+
+    struct TTokenHash {
+        std::size_t operator()(const TToken& token) const;
+    };
+
+    using TTemplates = std::unordered_map<TToken, TTemplate, TTokenHash>;
+
+    /**
+     * The number of the templates kept at most. All of them are dropped when there are more.
+     */
+    static constexpr std::size_t MAX_TEMPLATES = 1024;
+
+    static TTemplate Compile(const TToken& token);
+    TToken Splice(const TToken& token, const TTemplate& compiled) const;
+    const TTemplates::value_type& FindTemplate(const TToken& token);
+
     TEnvironment& Environment_;
+    TTemplates Templates_;
 };
 
 } // namespace NCli
\ No newline at end of file
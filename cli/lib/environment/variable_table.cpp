@@ -0,0 +1,94 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "variable_table.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace NCli {
+namespace NPrivate {
+
+std::size_t TVariableTable::Hash(std::string_view name) {
+    return std::hash<std::string_view>()(name);
+}
+
+std::size_t TVariableTable::Find(std::string_view name, std::size_t hash) const {
+    if (Buckets_.empty()) {
+        return NPOS;
+    }
+    std::size_t mask = Buckets_.size() - 1;
+    for (std::size_t bucket = hash & mask; Buckets_[bucket] != EMPTY_BUCKET; bucket = (bucket + 1) & mask) {
+        const TVariable& variable = Variables_[Buckets_[bucket]];
+        if (variable.Hash == hash && variable.Name == name) {
+            return Buckets_[bucket];
+        }
+    }
+    return NPOS;
+}
+
+std::size_t TVariableTable::Insert(std::string_view name, std::size_t hash) {
+    // The load factor is kept at most one half, so the probe sequences stay short.
+    if ((Variables_.size() + 1) * 2 > Buckets_.size()) {
+        Rehash(std::max<std::size_t>(16, Buckets_.size() * 2));
+    }
+
+    std::size_t index = Variables_.size();
+    Variables_.push_back(TVariable{std::string(name), std::string(), hash});
+
+    std::size_t mask = Buckets_.size() - 1;
+    std::size_t bucket = hash & mask;
+    while (Buckets_[bucket] != EMPTY_BUCKET) {
+        bucket = (bucket + 1) & mask;
+    }
+    Buckets_[bucket] = static_cast<std::uint32_t>(index);
+    return index;
+}
+
+TVariableTable::TVariable& TVariableTable::operator[](std::size_t index) {
+    return Variables_[index];
+}
+
+const TVariableTable::TVariable& TVariableTable::operator[](std::size_t index) const {
+    return Variables_[index];
+}
+
+std::size_t TVariableTable::Size() const {
+    return Variables_.size();
+}
+
+std::deque<TVariableTable::TVariable>::const_iterator TVariableTable::begin() const {
+    return Variables_.begin();
+}
+
+std::deque<TVariableTable::TVariable>::const_iterator TVariableTable::end() const {
+    return Variables_.end();
+}
+
+void TVariableTable::Rehash(std::size_t buckets) {
+    Buckets_.assign(buckets, EMPTY_BUCKET);
+    std::size_t mask = buckets - 1;
+    for (std::size_t index = 0; index != Variables_.size(); index++) {
+        std::size_t bucket = Variables_[index].Hash & mask;
+        while (Buckets_[bucket] != EMPTY_BUCKET) {
+            bucket = (bucket + 1) & mask;
+        }
+        Buckets_[bucket] = static_cast<std::uint32_t>(index);
+    }
+}
+
+} // namespace NPrivate
+} // namespace NCli
@@ -0,0 +1,95 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace NCli {
+namespace NPrivate {
+
+/**
+ * A single layer of variables: an open-addressing hash table with linear probing over the variables stored in the
+ * order of their creation.
+ *
+ * The variables are never removed, so the index of a variable is stable, even in a copy of the table. The hash of a
+ * name is computed by the caller, so a lookup through several layers hashes the name once and makes a single probe
+ * sequence per layer.
+ */
+class TVariableTable final {
+public:
+    /**
+     * A variable with its name hash.
+     */
+    struct TVariable {
+        std::string Name;
+        std::string Value;
+        std::size_t Hash = 0;
+    };
+
+    /**
+     * Returned by {@link NCli::NPrivate::TVariableTable::Find} when there is no such variable.
+     */
+    static constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+
+    /**
+     * Returns the hash of a variable name.
+     */
+    static std::size_t Hash(std::string_view name);
+
+    /**
+     * Returns the index of the variable {@arg name} with hash {@arg hash}, or NPOS.
+     */
+    std::size_t Find(std::string_view name, std::size_t hash) const;
+
+    /**
+     * Creates a variable with an empty value, which must not exist yet, and returns its index.
+     */
+    std::size_t Insert(std::string_view name, std::size_t hash);
+
+    /**
+     * Returns the variable with the given index.
+     */
+    TVariable& operator[](std::size_t index);
+    const TVariable& operator[](std::size_t index) const;
+
+    /**
+     * Returns the number of variables.
+     */
+    std::size_t Size() const;
+
+    /**
+     * Iterates over the variables in the order of their creation.
+     */
+    std::deque<TVariable>::const_iterator begin() const;
+    std::deque<TVariable>::const_iterator end() const;
+
+private:
+    static constexpr std::uint32_t EMPTY_BUCKET = static_cast<std::uint32_t>(-1);
+
+    void Rehash(std::size_t buckets);
+
+    std::deque<TVariable> Variables_;
+    std::vector<std::uint32_t> Buckets_;
+};
+
+} // namespace NPrivate
+} // namespace NCli
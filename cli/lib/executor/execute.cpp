@@ -16,12 +16,23 @@
 
 #include "execute.h"
 
+#include <common/fd_stream.h>
+#include <common/pipe.h>
 #include <executor/executor.h>
+#include <executor/private/detached_executor_base.h>
+#include <executor/private/in_process_executor_base.h>
 
+#include <algorithm>
+#include <exception>
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <thread>
 #include <vector>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 namespace NCli {
 namespace {
 
@@ -29,31 +40,249 @@ TExecutorPtr SelectExecutor(const TCommand& command, TEnvironment& environment)
     return TExecutorFactory::MakeExecutor(command.Command(), environment);
 }
 
-} // namespace <anonymous>
+void DrainToStream(int fd, std::size_t bufferSize, std::ostream& out) {
+    std::vector<char> buf(bufferSize);
+    while (true) {
+        ssize_t status = read(fd, buf.data(), buf.size());
+        if (status < 0 && errno == EINTR) {
+            continue;
+        }
+        if (status <= 0) {
+            break;
+        }
+        out.write(buf.data(), status);
+    }
+}
 
-void Execute(const TFullCommand& fullCommand, TEnvironment& environment, IIStreamWrapper& in, std::ostream& out) {
-    if (fullCommand.empty()) {
-        return;
+enum class EStageKind {
+    /**
+     * The stage is executed in a separate process.
+     */
+    FORKED,
+
+    /**
+     * The stage is executed on a separate thread of the shell.
+     */
+    THREADED,
+
+    /**
+     * The stage does not read its input and is executed in place.
+     */
+    INLINE
+};
+
+EStageKind StageKind(const TExecutorPtr& executor) {
+    if (std::dynamic_pointer_cast<NPrivate::TDetachedExecutorBase>(executor)) {
+        return EStageKind::FORKED;
+    } else if (std::dynamic_pointer_cast<NPrivate::TInProcessExecutorBase>(executor)) {
+        return EStageKind::THREADED;
+    } else {
+        return EStageKind::INLINE;
+    }
+}
+
+/**
+ * Executes a pipeline of several commands.
+ *
+ * All the stages are started at once and connected with pipes, so the data is streamed through the pipeline instead
+ * of being accumulated between the stages. The pipe number i is the input of the stage number i and the output of the
+ * stage number i - 1.
+ *
+ * External commands are forked first, then the built-ins reading their input are started on their own threads and,
+ * finally, the remaining built-ins, which never read their input, are executed in place. The first pipe is fed from
+ * {@arg in} and the last one is drained to {@arg out} only if the corresponding stages are forked: the threads and
+ * the built-ins use those streams directly.
+ */
+void ExecutePipeline(const TFullCommand& fullCommand, TEnvironment& environment, IIStreamWrapper& in,
+                     std::ostream& out) {
+    TBrokenPipeSignalGuard ignoreBrokenPipes;
+
+    std::size_t stages = fullCommand.size();
+    std::vector<TExecutorPtr> executors;
+    std::vector<EStageKind> kinds;
+    executors.reserve(stages);
+    kinds.reserve(stages);
+    for (const TCommand& command : fullCommand) {
+        executors.push_back(SelectExecutor(command, environment));
+        kinds.push_back(StageKind(executors.back()));
+    }
+
+    // The built-ins executed in place may modify the environment while the threads are reading it, so the threads
+    // are given a copy of it, just like a forked process would be. The copy shares the variables until one of the
+    // sides changes them, so it takes constant time.
+    std::optional<TEnvironment> snapshot;
+    bool hasInline = std::count(kinds.begin(), kinds.end(), EStageKind::INLINE) != 0;
+    for (std::size_t i = 0; i != stages; i++) {
+        if (hasInline && kinds[i] == EStageKind::THREADED) {
+            if (!snapshot.has_value()) {
+                snapshot = environment;
+            }
+            executors[i] = SelectExecutor(fullCommand[i], snapshot.value());
+        }
+    }
+
+    // The buffers of the stages are as large as the pipes, so that a full pipe is emptied in a single read. The
+    // capacities are taken before any stage starts: the stages close the ends of the pipes concurrently.
+    std::vector<TPipe> pipes(stages + 1);
+    std::vector<std::size_t> capacities;
+    capacities.reserve(stages + 1);
+    std::size_t capacity = NPrivate::PipeCapacity(environment);
+    for (TPipe& pipe : pipes) {
+        capacities.push_back(pipe.SetCapacity(capacity));
+    }
+    std::vector<pid_t> children;
+    for (std::size_t i = 0; i != stages; i++) {
+        if (kinds[i] != EStageKind::FORKED) {
+            continue;
+        }
+        auto executor = std::static_pointer_cast<NPrivate::TDetachedExecutorBase>(executors[i]);
+        NPrivate::TChildRedirections redirections;
+        if (i != 0 || in.IsPiped()) {
+            redirections.Stdin = pipes[i].ReadEndDescriptor();
+        }
+        redirections.Stdout = pipes[i + 1].WriteEndDescriptor();
+        for (const TPipe& pipe : pipes) {
+            for (int fd : pipe.OpenDescriptors()) {
+                redirections.Close.push_back(fd);
+            }
+        }
+        try {
+            children.push_back(executor->Spawn(fullCommand[i], redirections));
+        } catch (...) {
+            // The stages already running see EOF or EPIPE once the pipes are closed.
+            for (TPipe& pipe : pipes) {
+                pipe.Close();
+            }
+            for (pid_t child : children) {
+                waitpid(child, nullptr, 0);
+            }
+            throw;
+        }
+    }
+
+    for (std::size_t i = 1; i != stages; i++) {
+        bool writesHere = kinds[i - 1] != EStageKind::FORKED;
+        bool readsHere = kinds[i] == EStageKind::THREADED;
+        if (writesHere && readsHere) {
+            pipes[i].RegisterDirection(TPipe::EDirection::BOTH);
+        } else if (writesHere) {
+            pipes[i].RegisterDirection(TPipe::EDirection::OUT);
+        } else if (readsHere) {
+            pipes[i].RegisterDirection(TPipe::EDirection::IN);
+        } else {
+            pipes[i].Close();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> stageErrors(stages);
+    if (kinds.front() == EStageKind::FORKED) {
+        pipes.front().RegisterDirection(TPipe::EDirection::OUT);
+        threads.emplace_back([&pipes, &capacities, &in]() {
+            in.CopyContentToFile(pipes.front().WriteEndDescriptor(), capacities.front());
+            pipes.front().CloseWriteEnd();
+        });
+    } else {
+        pipes.front().Close();
+    }
+
+    if (kinds.back() == EStageKind::FORKED) {
+        pipes.back().RegisterDirection(TPipe::EDirection::IN);
+        threads.emplace_back([&pipes, &capacities, &out]() {
+            DrainToStream(pipes.back().ReadEndDescriptor(), capacities.back(), out);
+        });
+    } else {
+        pipes.back().Close();
+    }
+
+    for (std::size_t i = 0; i != stages; i++) {
+        if (kinds[i] != EStageKind::THREADED) {
+            continue;
+        }
+        auto executor = std::static_pointer_cast<NPrivate::TInProcessExecutorBase>(executors[i]);
+        threads.emplace_back([&fullCommand, &pipes, &capacities, &in, &out, &stageErrors, executor, stages, i]() {
+            // The stage reports its own errors, but the streams may still fail to be set up. Such an error is
+            // rethrown once all of the stages are finished, as an exception escaping the thread would terminate
+            // the shell.
+            try {
+                std::optional<TFdIStream> stageIn;
+                std::optional<TFdOStream> stageOut;
+                if (i != 0) {
+                    stageIn.emplace(pipes[i].ReadEndDescriptor(), capacities[i]);
+                }
+                if (i + 1 != stages) {
+                    stageOut.emplace(pipes[i + 1].WriteEndDescriptor(), EFlushPolicy::FULL, capacities[i + 1]);
+                }
+                executor->RunStage(fullCommand[i],
+                                   stageIn.has_value() ? stageIn.value() : in.WrappedIStream(),
+                                   stageOut.has_value() ? stageOut.value() : out);
+            } catch (...) {
+                stageErrors[i] = std::current_exception();
+            }
+            if (i != 0) {
+                pipes[i].CloseReadEnd();
+            }
+            if (i + 1 != stages) {
+                pipes[i + 1].CloseWriteEnd();
+            }
+        });
+    }
+
+    std::exception_ptr error;
+    for (std::size_t i = 0; i != stages; i++) {
+        if (kinds[i] != EStageKind::INLINE) {
+            continue;
+        }
+        std::istringstream nothing;
+        TPipeIStreamWrapper noInput(nothing);
+        try {
+            if (i + 1 == stages) {
+                executors[i]->Execute(fullCommand[i], noInput, out);
+            } else {
+                TFdOStream stageOut(pipes[i + 1].WriteEndDescriptor(), EFlushPolicy::FULL, capacities[i + 1]);
+                executors[i]->Execute(fullCommand[i], noInput, stageOut);
+            }
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        if (i + 1 != stages) {
+            pipes[i + 1].CloseWriteEnd();
+        }
     }
 
-    std::vector<std::stringstream> intermediateStreams(fullCommand.size() - 1);
-    std::vector<std::shared_ptr<IIStreamWrapper>> intermediateIStreamWrappers(fullCommand.size() - 1);
-    std::vector<IIStreamWrapper*> istreams(fullCommand.size());
-    std::vector<std::ostream*> ostreams(fullCommand.size());
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (pid_t child : children) {
+        waitpid(child, nullptr, 0);
+    }
+    if (kinds.front() == EStageKind::THREADED) {
+        in.WrappedIStream().clear();
+    }
 
-    istreams[0] = &in;
-    for (std::size_t i = 1; i != fullCommand.size(); i++) {
-        intermediateIStreamWrappers[i - 1] = std::make_shared<TPipeIStreamWrapper>(intermediateStreams[i - 1]);
-        istreams[i] = intermediateIStreamWrappers[i - 1].get();
+    for (std::exception_ptr stageError : stageErrors) {
+        if (!error) {
+            error = stageError;
+        }
     }
-    ostreams.back() = &out;
-    for (std::size_t i = 0; i + 1 != fullCommand.size(); i++) {
-        ostreams[i] = &intermediateStreams[i];
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace <anonymous>
+
+void Execute(const TFullCommand& fullCommand, TEnvironment& environment, IIStreamWrapper& in, std::ostream& out) {
+    if (fullCommand.empty()) {
+        return;
     }
 
-    for (std::size_t i = 0; i != fullCommand.size(); i++) {
-        const TCommand& command = fullCommand[i];
-        SelectExecutor(command, environment)->Execute(command, *istreams[i], *ostreams[i]);
+    if (fullCommand.size() == 1) {
+        SelectExecutor(fullCommand.front(), environment)->Execute(fullCommand.front(), in, out);
+    } else {
+        ExecutePipeline(fullCommand, environment, in, out);
     }
 }
 
@@ -40,6 +40,8 @@ TExecutorPtr TExecutorFactory::MakeExecutor(const std::string& command, TEnviron
         return std::make_shared<NPrivate::TCdExecutor>(globalEnvironment);
     } else if (command == "ls") {
         return std::make_shared<NPrivate::TLsExecutor>(globalEnvironment);
+    } else if (command == "hash") {
+        return std::make_shared<NPrivate::THashExecutor>(globalEnvironment);
     } else {
         return std::make_shared<NPrivate::TExternalExecutor>(globalEnvironment);
     }
@@ -21,6 +21,7 @@
 #include <parser/parse.h>
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 namespace NCli {
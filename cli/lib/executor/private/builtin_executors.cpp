@@ -16,18 +16,35 @@
 
 #include "builtin_executors.h"
 
+#include <common/directory_walker.h>
 #include <common/exit_exception.h>
+#include <common/fd_stream.h>
+#include <common/parallel.h>
 #include <common/pipe.h>
+#include <executor/private/command_hash.h>
+#include <executor/private/grep_matcher.h>
+#include <executor/private/wc_counter.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <regex>
+#include <sstream>
+#include <string_view>
+#include <vector>
 
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 
 #include <CLI/CLI11.hpp>
@@ -60,7 +77,7 @@ void TEchoExecutor::Execute(const TCommand& cmd, IIStreamWrapper&, std::ostream&
     if (cmd.Args().size() > 1) {
         os << cmd.Args().back();
     }
-    os << std::endl;
+    os << '\n';
 }
 
 namespace {
@@ -77,36 +94,135 @@ std::optional<std::string> ResolveFilename(TCmdEnvironment& env, std::string fil
     return {};
 }
 
+/**
+ * This exception is thrown whenever bad options are passed to a built-in. It is added in order to incapsulate
+ * both error message and expected error code from CLI11. For some reason, it is CLI::App's responsibility to choose
+ * the return code and the main idea of putting {@link ParseArgs} code into separate function is to abstract from
+ * concrete command line flags parser.
+ */
+class TBadOptionsException final : public std::runtime_error {
+public:
+    TBadOptionsException(const std::string& message, int retCode)
+        : std::runtime_error(message)
+        , RetCode_(retCode)
+    {}
+
+    int RetCode() const {
+        return RetCode_;
+    }
+
+private:
+    int RetCode_;
+};
+
+/**
+ * Parses the arguments of the command with the options added to {@arg app}.
+ *
+ * @throws TBadOptionsException if the arguments are not accepted; the message is already printed by CLI11.
+ */
+void ParseArgs(CLI::App& app, const TCommand& command) {
+    try {
+        std::vector<char*> args;
+        std::transform(command.Args().begin(), command.Args().end(), std::back_inserter(args),
+                       [](const std::string& s) { return const_cast<char*>(s.c_str()); }
+        );
+        app.parse((int)args.size(), args.data());
+    } catch (CLI::ParseError& e) {
+        throw TBadOptionsException(e.what(), app.exit(e));
+    }
+}
+
 } // namespace <anonymous>
 
 TCatExecutor::TCatExecutor(TEnvironment& environment)
-    : TDetachedExecutorBase(environment)
+    : TInProcessExecutorBase(environment)
 {}
 
-int TCatExecutor::ExecuteChild(const TCommand& command, TCmdEnvironment& env) {
-    if (command.Args().size() > 2) {
-        std::cerr << "cat: Too many arguments" << std::endl;
-        return 1;
+namespace {
+
+/**
+ * The size of the blocks cat copies in when the data cannot be moved between descriptors.
+ */
+constexpr std::size_t CAT_BLOCK_SIZE = 1 << 17;
+
+/**
+ * Copies the file open as {@arg fd} to {@arg out}. When the stream writes to a descriptor, {@arg fdOut}, the buffered
+ * output is written first and the data is moved between the descriptors in the kernel.
+ *
+ * @return Whether all the data was copied.
+ */
+bool CatFd(int fd, std::ostream& out, TFdOStream* fdOut) {
+    if (fdOut != nullptr) {
+        out.flush();
+        return CopyFd(fd, fdOut->Fd());
+    }
+    std::unique_ptr<char[]> buffer(new char[CAT_BLOCK_SIZE]);
+    for (ssize_t got; (got = ReadSome(fd, buffer.get(), CAT_BLOCK_SIZE)) > 0;) {
+        out.write(buffer.get(), got);
     }
+    return static_cast<bool>(out);
+}
 
-    if (command.Args().size() == 1 || command.Args()[1] == "-") {
-        std::copy(std::istreambuf_iterator<char>(std::cin),
-                  std::istreambuf_iterator<char>(),
-                  std::ostreambuf_iterator<char>(std::cout));
-    } else {
-        auto file = ResolveFilename(env, command.Args()[1]);
-        if (file.has_value()) {
-            std::ifstream fin(file.value());
-            std::copy(std::istreambuf_iterator<char>(fin),
-                      std::istreambuf_iterator<char>(),
-                      std::ostreambuf_iterator<char>(std::cout));
-        } else {
-            std::cerr << "cat: " << command.Args()[1] << ": No such file or directory" << std::endl;
+/**
+ * Copies the input stream to {@arg out}, with the descriptors of both streams if they are known, after the data
+ * already buffered by the input stream.
+ */
+bool CatStream(std::istream& in, std::ostream& out, TFdOStream* fdOut) {
+    std::streambuf* buf = in.rdbuf();
+    std::unique_ptr<char[]> buffer(new char[CAT_BLOCK_SIZE]);
+    auto* fdIn = dynamic_cast<TFdIStream*>(&in);
+    if (fdIn != nullptr && fdOut != nullptr) {
+        for (std::streamsize buffered; (buffered = buf->in_avail()) > 0;) {
+            out.write(buffer.get(), buf->sgetn(buffer.get(), std::min<std::streamsize>(buffered, CAT_BLOCK_SIZE)));
+        }
+        return CatFd(fdIn->Fd(), out, fdOut);
+    }
+    for (std::streamsize got; (got = buf->sgetn(buffer.get(), CAT_BLOCK_SIZE)) > 0;) {
+        out.write(buffer.get(), got);
+    }
+    return static_cast<bool>(out);
+}
+
+} // namespace <anonymous>
+
+int TCatExecutor::Run(const TCommand& command, TCmdEnvironment& env, std::istream& in, std::ostream& out) {
+    std::vector<std::string> operands(command.Args().begin() + 1, command.Args().end());
+    if (operands.empty()) {
+        operands.push_back("-");
+    }
+
+    // The output of the shell and of the pipeline stages are descriptor streams, so the data usually never comes to
+    // the user space at all.
+    auto* fdOut = dynamic_cast<TFdOStream*>(&out);
+    int exitCode = 0;
+    for (const std::string& operand : operands) {
+        if (operand == "-") {
+            if (!CatStream(in, out, fdOut)) {
+                return 1;
+            }
+            continue;
+        }
+
+        auto file = ResolveFilename(env, operand);
+        if (!file.has_value()) {
+            std::cerr << "cat: " << operand << ": No such file or directory" << std::endl;
+            exitCode = 1;
+            continue;
+        }
+        int fd = open(file.value().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            std::cerr << "cat: " << operand << ": " << std::strerror(errno) << std::endl;
+            exitCode = 1;
+            continue;
+        }
+        bool copied = CatFd(fd, out, fdOut);
+        close(fd);
+        if (!copied) {
             return 1;
         }
     }
 
-    return 0;
+    return exitCode;
 }
 
 TPwdExecutor::TPwdExecutor(TEnvironment& environment)
@@ -114,162 +230,270 @@ TPwdExecutor::TPwdExecutor(TEnvironment& environment)
 {}
 
 void TPwdExecutor::Execute(const TCommand&, IIStreamWrapper&, std::ostream& os) {
-    os << Environment_["PWD"] << std::endl;
+    os << Environment_.GetValue("PWD") << '\n';
 }
 
 TWcExecutor::TWcExecutor(TEnvironment& environment)
-    : TDetachedExecutorBase(environment)
+    : TInProcessExecutorBase(environment)
 {}
 
-int TWcExecutor::ExecuteChild(const TCommand& cmd, TCmdEnvironment& cmdEnv) {
-    if (cmd.Args().size() > 2) {
-        std::cerr << "wc: Too many arguments" << std::endl;
-        return 1;
-    }
+namespace {
 
-    bool readFromStdin = cmd.Args().size() == 1 || cmd.Args()[1] == "-";
+/**
+ * The size of the blocks the input of wc is read in.
+ */
+constexpr std::size_t WC_BLOCK_SIZE = 1 << 17;
 
-    std::optional<std::string> resolvedFile = {};
-    if (!readFromStdin) {
-        resolvedFile = ResolveFilename(cmdEnv, cmd.Args()[1]);
-    }
-    if (!readFromStdin && !resolvedFile.has_value()) {
-        std::cerr << "wc: " + cmd.Args()[1] + ": No such file or directory" << std::endl;
-        return 1;
-    }
-    std::unique_ptr<std::istream> fs;
-    if (!readFromStdin) {
-        fs = std::make_unique<std::ifstream>(resolvedFile.value());
-    } else {
-        std:: string allStdin;
-        std::copy(std::istreambuf_iterator<char>(std::cin),
-                  std::istreambuf_iterator<char>(),
-                  std::back_inserter(allStdin));
-        fs = std::make_unique<std::istringstream>(allStdin);
-    }
+/**
+ * Regular files larger than this are counted in chunks of this size, which may be counted on different threads.
+ */
+constexpr std::uint64_t WC_CHUNK_SIZE = 1 << 25;
 
-    std::istream& readFrom = *fs;
+struct TWcOpts {
+    bool Lines;
+    bool Words;
+    bool Bytes;
+    std::vector<std::string> Filenames;
+};
 
-    long lines = 0;
-    {
-        std::string s;
-        while (std::getline(readFrom, s)) {
-            lines++;
-        }
-        readFrom.clear();
-        readFrom.seekg(0, std::ios::beg);
-    }
+TWcOpts ParseWcArgs(const TCommand& command) {
+    CLI::App app{"Print newline, word, and byte counts for each FILE, and a total line if more than one FILE is "
+                 "specified"};
 
-    long words = 0;
-    {
-        std::string s;
-        while (readFrom >> s) {
-            words++;
-        }
-        readFrom.clear();
-        readFrom.seekg(0, std::ios::beg);
-    }
+    TWcOpts opts;
+    app.add_flag("-l,--lines", opts.Lines, "print the newline counts");
+    app.add_flag("-w,--words", opts.Words, "print the word counts");
+    app.add_flag("-c,--bytes", opts.Bytes, "print the byte counts");
+    app.add_option("files", opts.Filenames, "FILES");
 
-    long bytes = 0;
-    {
-        readFrom.seekg(0, std::ios::end);
-        bytes = readFrom.tellg();
+    ParseArgs(app, command);
+    if (!opts.Lines && !opts.Words && !opts.Bytes) {
+        opts.Lines = opts.Words = opts.Bytes = true;
     }
-
-    std::cout << "\t" << lines << "\t" << words << "\t" << bytes << std::endl;
-    return 0;
+    return opts;
 }
 
-namespace {
-
 /**
- * This interface represents strategy used to determine whether to select line or not. Currently there are at least two
- * separate strategies: the default and for word regexs.
+ * A part of an input of wc counted at once: the standard input, a whole file or a chunk of a regular file.
  */
-class IGrepStrategy {
-public:
+struct TWcPart {
     /**
-     * Returns whether a line should be printed or not.
+     * The index of the input among the arguments.
      */
-    virtual bool LineMatches(const std::regex& pattern, const std::string& line) = 0;
-};
+    std::size_t Input = 0;
 
-using TGrepStrategyPtr = std::shared_ptr<IGrepStrategy>;
+    /**
+     * The file to count, empty for the standard input.
+     */
+    std::string Filename;
 
-/**
- * This represents the default strategy.
- */
-class TGrepLineRegexp final : public IGrepStrategy {
-public:
     /**
-     * The line is accepted if it contains a matching substring.
+     * The error number to report instead of counting, if any.
      */
-    bool LineMatches(const std::regex& pattern, const std::string& line) override {
-        return std::regex_search(line, pattern);
-    }
-};
+    int Error = 0;
 
-/**
- * This represent the whole-word strategy.
- */
-class TGrepWordRegexp final : public IGrepStrategy {
     /**
-     * {@see grep(1)}
+     * The chunk of a regular file, or the whole file read to its end if the size is not known.
      */
-    bool IsWordConstituentCharacter(char c) {
-        return std::isalnum(c) || c == '_';
-    }
+    std::uint64_t Offset = 0;
+    std::optional<std::uint64_t> Size;
 
-public:
+    /**
+     * Whether only the size of the part is needed, which is known without reading it.
+     */
+    bool SizeOnly = false;
 
     /**
-     * The line is accepted if it contains a matching substring that is a whole word. More formally, either line start
-     * or a non-word constituent character must be to the left of the match and the similar condition must satisfy
-     * at the right of the match.
+     * Whether this is the last part of the input.
      */
-    bool LineMatches(const std::regex& pattern, const std::string& line) override {
-        std::string lineCopy = line;
+    bool Last = true;
+};
 
-        std::sregex_iterator end;
-        for (std::sregex_iterator match(line.begin(), line.end(), pattern); match != end; match++) {
-            if (!(match->prefix().str().empty() || !IsWordConstituentCharacter(match->prefix().str().back()))) {
-                continue;
-            }
-            if (!(match->suffix().str().empty() || !IsWordConstituentCharacter(match->suffix().str()[0]))) {
-                continue;
-            }
-            return true;
+/**
+ * Splits the inputs of wc into the parts counted separately.
+ */
+std::vector<TWcPart> PlanWcParts(const TWcOpts& opts, TCmdEnvironment& env, const std::vector<std::string>& inputs) {
+    std::vector<TWcPart> parts;
+    for (std::size_t i = 0; i != inputs.size(); i++) {
+        TWcPart part;
+        part.Input = i;
+        if (inputs[i] == "-") {
+            parts.push_back(part);
+            continue;
         }
 
-        return false;
+        auto filename = ResolveFilename(env, inputs[i]);
+        struct stat st;
+        if (!filename.has_value()) {
+            part.Error = ENOENT;
+        } else if (stat(filename.value().c_str(), &st) == -1) {
+            part.Error = errno;
+        } else {
+            part.Filename = filename.value();
+        }
+        if (part.Error != 0 || !S_ISREG(st.st_mode)) {
+            parts.push_back(part);
+            continue;
+        }
+
+        auto size = static_cast<std::uint64_t>(st.st_size);
+        if (!opts.Lines && !opts.Words) {
+            part.Size = size;
+            part.SizeOnly = true;
+            parts.push_back(part);
+            continue;
+        }
+        for (std::uint64_t offset = 0; offset == 0 || offset < size; offset += WC_CHUNK_SIZE) {
+            part.Offset = offset;
+            part.Size = std::min(WC_CHUNK_SIZE, size - offset);
+            part.Last = offset + WC_CHUNK_SIZE >= size;
+            parts.push_back(part);
+        }
     }
-};
+    return parts;
+}
 
 /**
- * This exception is thrown whenever bad options are passed to the grep executor. It is added in order to incapsulate
- * both error message and expected error code from CLI11. For some reason, it is CLI::App's responsibility to choose
- * the return code and the main idea of putting {@link ParseGrepArgs} code into separate function is to abstract from
- * concrete command line flags parser.
+ * Counts the part of an input. The error number is stored to {@arg error} if the part could not be read.
  */
-class TGrepBadOptionsException final : public std::runtime_error {
-public:
-    TGrepBadOptionsException(const std::string& message, int retCode)
-        : std::runtime_error(message)
-        , RetCode_(retCode)
-    {}
+TWcCounter CountWcPart(const TWcOpts& opts, const TWcPart& part, std::istream& in, int& error) {
+    TWcCounter counter(opts.Words);
+    if (part.SizeOnly) {
+        counter.AddBytes(part.Size.value());
+        return counter;
+    }
 
-    int RetCode() const {
-        return RetCode_;
+    // The buffer is kept by the thread, so that counting many small files does not allocate a block for each of them.
+    thread_local std::vector<char> buffer(WC_BLOCK_SIZE);
+    if (part.Filename.empty()) {
+        std::streambuf* buf = in.rdbuf();
+        for (std::streamsize got; (got = buf->sgetn(buffer.data(), buffer.size())) > 0;) {
+            counter.Update(std::string_view(buffer.data(), got));
+        }
+        return counter;
     }
 
-private:
-    int RetCode_;
-};
+    int fd = open(part.Filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        error = errno;
+        return counter;
+    }
+    posix_fadvise(fd, part.Offset, part.Size.value_or(0), POSIX_FADV_SEQUENTIAL);
+    std::uint64_t left = part.Size.value_or(std::numeric_limits<std::uint64_t>::max());
+    for (std::uint64_t offset = part.Offset; left != 0;) {
+        // Only the chunks of regular files are read at their offsets: pipes and devices cannot seek.
+        std::size_t size = std::min<std::uint64_t>(buffer.size(), left);
+        ssize_t got = part.Size.has_value() ? pread(fd, buffer.data(), size, offset) : read(fd, buffer.data(), size);
+        if (got == -1 && errno == EINTR) {
+            continue;
+        }
+        if (got == -1) {
+            error = errno;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        counter.Update(std::string_view(buffer.data(), got));
+        offset += got;
+        left -= got;
+    }
+    close(fd);
+    return counter;
+}
+
+void PrintWcCounts(const TWcOpts& opts, const TWcCounts& counts, const std::string* name, std::ostream& out) {
+    if (opts.Lines) {
+        out << "\t" << counts.Lines;
+    }
+    if (opts.Words) {
+        out << "\t" << counts.Words;
+    }
+    if (opts.Bytes) {
+        out << "\t" << counts.Bytes;
+    }
+    if (name != nullptr) {
+        out << "\t" << *name;
+    }
+    out << '\n';
+}
+
+} // namespace <anonymous>
+
+int TWcExecutor::Run(const TCommand& cmd, TCmdEnvironment& cmdEnv, std::istream& in, std::ostream& out) {
+    TWcOpts opts;
+    try {
+        opts = ParseWcArgs(cmd);
+    } catch (TBadOptionsException& e) {
+        return e.RetCode();
+    }
+
+    // A single input is printed without its name and without the total.
+    std::vector<std::string> inputs = opts.Filenames;
+    if (inputs.empty()) {
+        inputs.push_back("-");
+    }
+    bool named = inputs.size() > 1;
+
+    // The parts of the files are counted on a pool of threads, each one block by block in a single pass, and are
+    // put together in order on the calling thread. The standard input is shared by all of the "-" operands, so it is
+    // counted on the calling thread as well: the first of them reads it to the end and the others find it empty.
+    std::vector<TWcPart> parts = PlanWcParts(opts, cmdEnv, inputs);
+    int exitCode = 0;
+    TWcCounter counter;
+    int error = 0;
+    TWcCounts total;
+    ForEachOrdered(parts.size(), DefaultJobs(),
+        [&](std::size_t i) {
+            int partError = parts[i].Error;
+            TWcCounter partCounter;
+            if (partError == 0 && !parts[i].Filename.empty()) {
+                partCounter = CountWcPart(opts, parts[i], in, partError);
+            }
+            return std::make_pair(partCounter, partError);
+        },
+        [&](std::size_t i, std::pair<TWcCounter, int> counted) {
+            const TWcPart& part = parts[i];
+            if (counted.second == 0 && part.Filename.empty()) {
+                counted.first = CountWcPart(opts, part, in, counted.second);
+            }
+            if (error == 0) {
+                error = counted.second;
+                counter.Append(counted.first);
+            }
+            if (!part.Last) {
+                return;
+            }
+
+            if (error != 0) {
+                std::cerr << "wc: " << inputs[part.Input] << ": " << std::strerror(error) << std::endl;
+                exitCode = 1;
+            } else {
+                TWcCounts counts = counter.Counts();
+                PrintWcCounts(opts, counts, named ? &inputs[part.Input] : nullptr, out);
+                total.Lines += counts.Lines;
+                total.Words += counts.Words;
+                total.Bytes += counts.Bytes;
+            }
+            counter = TWcCounter();
+            error = 0;
+        });
+
+    if (named) {
+        const std::string name = "total";
+        PrintWcCounts(opts, total, &name, out);
+    }
+    return exitCode;
+}
+
+namespace {
 
 struct TGrepOpts {
     bool IgnoreCase;
     bool WordRegexp;
+    bool Recursive;
     std::optional<int> AfterContext;
+    std::optional<int> Jobs;
     std::string Pattern;
     std::vector<std::string> Filenames;
 };
@@ -280,83 +504,293 @@ TGrepOpts ParseGrepArgs(const TCommand& command) {
     TGrepOpts opts;
     app.add_flag("-i,--ignore-case", opts.IgnoreCase, "ignore case distinctions");
     app.add_flag("-w,--word-regexp", opts.WordRegexp, "force PATTERN to match only whole words");
+    app.add_flag("-r,--recursive", opts.Recursive, "search the files in each directory FILE recursively");
     app.add_option("-A,--after-context", opts.AfterContext, "print NUM lines of trailing context");
+    app.add_option("-j,--jobs", opts.Jobs, "search up to NUM files at once")->check(CLI::Range(1, 1024));
     app.add_option("pattern", opts.Pattern, "PATTERN")->required();
     app.add_option("files", opts.Filenames, "FILES");
 
-    try {
-        std::vector<char*> args;
-        std::transform(command.Args().begin(), command.Args().end(), std::back_inserter(args),
-                       [](const std::string& s) { return const_cast<char*>(s.c_str()); }
-        );
-        app.parse((int)args.size(), args.data());
-    } catch (CLI::ParseError& e) {
-        throw TGrepBadOptionsException(e.what(), app.exit(e));
-    }
-
+    ParseArgs(app, command);
     return opts;
 }
 
-void DoGrepIStream(const TGrepOpts& opts, const std::regex& pattern, TGrepStrategyPtr strategy, std::istream& is) {
-    int printLines = -1;
-    std::string s;
-    while (std::getline(is, s)) {
-        if (strategy->LineMatches(pattern, s)) {
+/**
+ * The size of the blocks the input of grep is read in.
+ */
+constexpr std::size_t GREP_BLOCK_SIZE = 1 << 18;
+
+/**
+ * Greps the complete lines at the beginning of {@arg data}, and the last line without a newline as well if the input
+ * is over. The number of the context lines still to be printed is kept in {@arg printLines} between the calls.
+ * Unless {@arg filename} is empty, the printed lines are prefixed with it and ':', or '-' for the context lines.
+ *
+ * While no context lines are pending, the whole data is searched for the needle of the matcher at once, and only the
+ * lines containing its occurrences are looked at.
+ *
+ * @return Number of bytes consumed.
+ */
+std::size_t GrepLines(const TGrepOpts& opts, const TGrepMatcher& matcher, std::string_view data, bool over,
+                      std::string_view filename, int& printLines, std::ostream& os) {
+    std::size_t end = data.size();
+    if (!over) {
+        std::size_t lastNewline = data.rfind('\n');
+        end = lastNewline == std::string_view::npos ? 0 : lastNewline + 1;
+    }
+    std::string_view lines = data.substr(0, end);
+    bool hasNeedle = !matcher.Needle().empty();
+
+    std::size_t pos = 0;
+    while (pos < lines.size()) {
+        if (printLines < 0 && hasNeedle) {
+            std::size_t hit = matcher.FindNeedle(lines, pos);
+            if (hit == std::string_view::npos) {
+                break;
+            }
+            const void* newline = memrchr(lines.data() + pos, '\n', hit - pos);
+            if (newline != nullptr) {
+                pos = static_cast<const char*>(newline) - lines.data() + 1;
+            }
+        }
+        std::size_t lineEnd = lines.find('\n', pos);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = lines.size();
+        }
+        std::string_view line = lines.substr(pos, lineEnd - pos);
+        bool matches = matcher.LineMatches(line);
+        if (matches) {
             printLines = opts.AfterContext.value_or(0);
         }
         if (printLines >= 0) {
-            std::cout << s << std::endl;
+            if (!filename.empty()) {
+                os << filename << (matches ? ':' : '-');
+            }
+            os << line << '\n';
             printLines--;
         }
+        pos = lineEnd + 1;
+    }
+    return end;
+}
+
+/**
+ * Greps the input coming block by block from {@arg read}, which stores at most the given number of bytes to the given
+ * buffer and returns the number of bytes stored, zero at the end of the input or -1 with errno set on error. The lines
+ * are prefixed with {@arg filename} unless it is empty.
+ *
+ * @return Whether the input was read to its end. The lines read before an error are still searched.
+ */
+template <typename TRead>
+bool DoGrep(const TGrepOpts& opts, const TGrepMatcher& matcher, TRead&& read, std::ostream& os,
+            std::string_view filename = {}) {
+    // The buffer is kept by the thread, so that searching many small files does not allocate and clear a block for
+    // every one of them.
+    thread_local std::vector<char> buffer;
+    buffer.resize(GREP_BLOCK_SIZE);
+    buffer.shrink_to_fit();
+    std::size_t size = 0;
+    int printLines = -1;
+    while (true) {
+        if (size == buffer.size()) {
+            // A line longer than the buffer.
+            buffer.resize(buffer.size() * 2);
+        }
+        ssize_t got = read(buffer.data() + size, buffer.size() - size);
+        if (got <= 0) {
+            int error = errno;
+            GrepLines(opts, matcher, std::string_view(buffer.data(), size), true, filename, printLines, os);
+            errno = error;
+            return got == 0;
+        }
+        size += got;
+        if (std::memchr(buffer.data() + size - got, '\n', got) == nullptr) {
+            // Still no complete line to search.
+            continue;
+        }
+        std::size_t done = GrepLines(opts, matcher, std::string_view(buffer.data(), size), false, filename,
+                                     printLines, os);
+        std::memmove(buffer.data(), buffer.data() + done, size - done);
+        size -= done;
+    }
+}
+
+/**
+ * Greps the input stream.
+ *
+ * @return Whether the input was read to its end. The error number is left in errno otherwise.
+ */
+bool DoGrepIStream(const TGrepOpts& opts, const TGrepMatcher& matcher, std::istream& is, std::ostream& os) {
+    // Only the data available at once is taken, so that the lines of a slow pipe are printed as soon as they come.
+    // Once the buffer of the shell stdin is empty, its descriptor is read directly in blocks, just like an external
+    // grep would read it: a stream synchronized with stdio would be read byte by byte otherwise.
+    std::streambuf* buf = is.rdbuf();
+    bool shellStdin = buf == std::cin.rdbuf();
+    return DoGrep(opts, matcher, [buf, shellStdin](char* data, std::size_t size) -> ssize_t {
+        std::streamsize available = buf->in_avail();
+        if (available <= 0 && shellStdin) {
+            return ReadSome(STDIN_FILENO, data, size);
+        }
+        if (available <= 0) {
+            if (std::streambuf::traits_type::eq_int_type(buf->sgetc(), std::streambuf::traits_type::eof())) {
+                return 0;
+            }
+            available = std::max<std::streamsize>(buf->in_avail(), 1);
+        }
+        return buf->sgetn(data, std::min<std::streamsize>(available, size));
+    }, os);
+}
+
+/**
+ * Greps the file {@arg filename}.
+ *
+ * @return Whether the file could be opened and read. The error number is left in errno otherwise.
+ */
+bool DoGrepFile(const TGrepOpts& opts, const TGrepMatcher& matcher, const std::string& filename, std::ostream& os) {
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    bool read = DoGrep(opts, matcher, [fd](char* data, std::size_t size) {
+        return ReadSome(fd, data, size);
+    }, os);
+    int error = errno;
+    close(fd);
+    errno = error;
+    return read;
+}
+
+/**
+ * Greps the file {@arg name} in the directory open as {@arg dirFd} with the lines prefixed by {@arg path}, unless it
+ * is a binary file, that is, its first block contains a null byte.
+ *
+ * @return Whether the file could be opened and read. The error number is left in errno otherwise.
+ */
+bool DoGrepTextFile(const TGrepOpts& opts, const TGrepMatcher& matcher, int dirFd, const std::string& name,
+                    const std::string& path, std::ostream& os) {
+    int fd = openat(dirFd, name.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd == -1) {
+        return false;
     }
+    bool first = true;
+    bool read = DoGrep(opts, matcher, [fd, &first](char* data, std::size_t size) -> ssize_t {
+        ssize_t got = ReadSome(fd, data, size);
+        if (first && got > 0) {
+            first = false;
+            if (std::memchr(data, '\0', got) != nullptr) {
+                return 0;
+            }
+        }
+        return got;
+    }, os, path);
+    int error = errno;
+    close(fd);
+    errno = error;
+    return read;
 }
 
 } // namespace <anonymous>
 
 TGrepExecutor::TGrepExecutor(TEnvironment& globalEnvironment)
-        : TDetachedExecutorBase(globalEnvironment)
+        : TInProcessExecutorBase(globalEnvironment)
 {}
 
-int TGrepExecutor::ExecuteChild(const TCommand& command, TCmdEnvironment& env) {
+int TGrepExecutor::Run(const TCommand& command, TCmdEnvironment& env, std::istream& in, std::ostream& out) {
     TGrepOpts opts;
     try {
         opts = ParseGrepArgs(command);
-    } catch (TGrepBadOptionsException& e) {
+    } catch (TBadOptionsException& e) {
         return e.RetCode();
     }
 
-    TGrepStrategyPtr strategy;
-    if (opts.WordRegexp) {
-        strategy = std::make_shared<TGrepWordRegexp>();
-    } else {
-        strategy = std::make_shared<TGrepLineRegexp>();
-    }
-
-    auto regexStyle = std::regex_constants::grep;
-    if (opts.IgnoreCase) {
-        regexStyle |= std::regex_constants::icase;
-    }
-    std::regex pattern;
+    std::shared_ptr<const TGrepMatcher> matcher;
     try {
-        pattern = std::regex(opts.Pattern, regexStyle);
+        matcher = TGrepMatcher::Get(opts.Pattern, opts.IgnoreCase, opts.WordRegexp);
     } catch (std::regex_error& e) {
         std::cerr << "grep: " << e.what() << std::endl;
         return 2;
     }
 
     int exitCode = 0;
-    if (opts.Filenames.empty()) {
-        DoGrepIStream(opts, pattern, strategy, std::cin);
-    } else {
+    std::size_t jobs = opts.Jobs.has_value() ? opts.Jobs.value() : DefaultJobs();
+    if (opts.Recursive) {
+        // The files are searched on the threads walking the directories, and the lines found in a file are written
+        // at once, so the files come in no particular order but their lines are never mixed.
+        std::mutex outMutex;
+        auto fail = [&](const std::string& path, int error) {
+            std::lock_guard<std::mutex> lock(outMutex);
+            std::cerr << "grep: " << path << ": " << std::strerror(error) << std::endl;
+            exitCode = 2;
+        };
+        auto visit = [&](int dirFd, const std::string& name, const std::string& path) {
+            std::ostringstream os;
+            if (!DoGrepTextFile(opts, *matcher, dirFd, name, path, os)) {
+                fail(path, errno);
+                return;
+            }
+            std::string found = os.str();
+            if (!found.empty()) {
+                std::lock_guard<std::mutex> lock(outMutex);
+                out << found;
+            }
+        };
+
+        if (opts.Filenames.empty()) {
+            WalkFiles(".", "", jobs, visit, fail);
+        }
         for (const auto& file : opts.Filenames) {
             auto filename = ResolveFilename(env, file);
             if (!filename.has_value()) {
                 std::cerr << "grep: " << file << ": No such file or directory" << std::endl;
                 exitCode = 2;
             } else {
-                std::ifstream fin(filename.value());
-                DoGrepIStream(opts, pattern, strategy, fin);
+                WalkFiles(filename.value(), file, jobs, visit, fail);
+            }
+        }
+    } else if (opts.Filenames.empty()) {
+        if (!DoGrepIStream(opts, *matcher, in, out)) {
+            std::cerr << "grep: (standard input): " << std::strerror(errno) << std::endl;
+            exitCode = 2;
+        }
+    } else {
+        std::vector<std::optional<std::string>> filenames;
+        filenames.reserve(opts.Filenames.size());
+        for (const auto& file : opts.Filenames) {
+            filenames.push_back(ResolveFilename(env, file));
+        }
+
+        auto report = [&](std::size_t i, int error) {
+            std::cerr << "grep: " << opts.Filenames[i] << ": " << std::strerror(error) << std::endl;
+            exitCode = 2;
+        };
+
+        if (jobs <= 1 || filenames.size() <= 1) {
+            for (std::size_t i = 0; i != filenames.size(); i++) {
+                if (!filenames[i].has_value()) {
+                    report(i, ENOENT);
+                } else if (!DoGrepFile(opts, *matcher, filenames[i].value(), out)) {
+                    report(i, errno);
+                }
             }
+        } else {
+            // Files are searched into buffers on worker threads; the matcher is only used through const methods. The
+            // errors are reported along with the output, in order, on the calling thread.
+            ForEachOrdered(filenames.size(), jobs,
+                [&](std::size_t i) -> std::pair<std::string, int> {
+                    if (!filenames[i].has_value()) {
+                        return {std::string(), ENOENT};
+                    }
+                    std::ostringstream os;
+                    if (!DoGrepFile(opts, *matcher, filenames[i].value(), os)) {
+                        return {std::string(), errno};
+                    }
+                    return {os.str(), 0};
+                },
+                [&](std::size_t i, std::pair<std::string, int> found) {
+                    if (found.second != 0) {
+                        report(i, found.second);
+                    } else {
+                        out << found.first;
+                    }
+                });
         }
     }
 
@@ -374,9 +808,9 @@ void TLsExecutor::Execute(const TCommand& command, IIStreamWrapper&, std::ostrea
         std::cerr << "ls: Too many arguments" << std::endl;
         return;
     } else if (command.Args().size() < 2) {
-        path = fs::path(Environment_["PWD"]);
+        path = fs::path(Environment_.GetValue("PWD"));
     } else {
-        path = fs::path(Environment_["PWD"]) / command.Args()[1];
+        path = fs::path(Environment_.GetValue("PWD")) / command.Args()[1];
         if (!fs::exists(path)) {
             std::cerr << "ls: " << command.Args()[1] << ": No such file or directory" << std::endl;
             return;
@@ -390,7 +824,7 @@ void TLsExecutor::Execute(const TCommand& command, IIStreamWrapper&, std::ostrea
     for (auto s: res) {
         os << s << "  ";
     }
-    os << std::endl;
+    os << '\n';
 }
 
 TCdExecutor::TCdExecutor(TEnvironment &globalEnvironment)
@@ -404,16 +838,56 @@ void TCdExecutor::Execute(const TCommand& command, IIStreamWrapper&, std::ostrea
         std::cerr << "ls: Too many arguments" << std::endl;
         return;
     } else if (command.Args().size() < 2) {
-        path = fs::path(Environment_["HOME"]);
+        path = fs::path(Environment_.GetValue("HOME"));
     } else {
-        path = fs::path(Environment_["PWD"]) / command.Args()[1];
+        path = fs::path(Environment_.GetValue("PWD")) / command.Args()[1];
         if (!fs::exists(path)) {
             std::cerr << "cd: " << command.Args()[1] << ": No such file or directory" << std::endl;
             return;
         }
     }
-    Environment_["PWD"] = fs::canonical(path).string();
-    chdir(Environment_["PWD"].c_str());
+    std::string& pwd = Environment_["PWD"];
+    pwd = fs::canonical(path).string();
+    chdir(pwd.c_str());
+}
+
+THashExecutor::THashExecutor(TEnvironment& globalEnvironment)
+    : Environment_(globalEnvironment)
+{}
+
+void THashExecutor::Execute(const TCommand& command, IIStreamWrapper&, std::ostream& os) {
+    TCommandHashTable& table = TCommandHashTable::Instance();
+    const auto& args = command.Args();
+
+    if (args.size() == 1) {
+        auto entries = table.Entries();
+        if (entries.empty()) {
+            os << "hash: hash table empty\n";
+            return;
+        }
+        os << "hits\tcommand\n";
+        for (const auto& [name, entry] : entries) {
+            os << entry.Hits << "\t" << entry.Path << "\n";
+        }
+        return;
+    }
+
+    if (args[1] == "-r") {
+        table.Clear();
+        return;
+    }
+    if (args[1] == "-s") {
+        os << "hits\t" << table.Hits() << "\nmisses\t" << table.Misses() << "\n";
+        return;
+    }
+
+    TCmdEnvironment cmdEnv(Environment_);
+    UpdateCmdEnvironment(cmdEnv, command);
+    for (std::size_t i = 1; i != args.size(); i++) {
+        if (!table.Add(cmdEnv.GetValue("PATH"), args[i])) {
+            std::cerr << "hash: " << args[i] << ": not found" << std::endl;
+        }
+    }
 }
 
 } // namespace NPrivate
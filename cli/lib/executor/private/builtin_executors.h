@@ -17,7 +17,7 @@
 #pragma once
 
 #include <executor/executor.h>
-#include <executor/private/detached_executor_base.h>
+#include <executor/private/in_process_executor_base.h>
 
 namespace NCli {
 namespace NPrivate {
@@ -110,13 +110,14 @@ public:
 };
 
 /**
- * Writes the file content on stdout.
+ * Writes the content of the files on stdout, one after another.
  *
- * When given no arguments or `-` as an argument, writes content of stdout.
+ * When given no arguments or `-` as an argument, writes content of stdin. When both streams are backed by descriptors,
+ * the data is moved between them in the kernel.
  *
  * This is the executor for builtin command `cat`.
  */
-class TCatExecutor final : public TDetachedExecutorBase {
+class TCatExecutor final : public TInProcessExecutorBase {
 public:
     /**
      * Creates the executor.
@@ -136,7 +137,7 @@ public:
     /**
      * Executes the command.
      */
-    int ExecuteChild(const TCommand& command, TCmdEnvironment& env) override;
+    int Run(const TCommand& command, TCmdEnvironment& env, std::istream& in, std::ostream& out) override;
 };
 
 /**
@@ -171,11 +172,14 @@ private:
 };
 
 /**
- * Prints number of symbols, words and lines in standard input or in file.
+ * Prints number of lines, words and bytes in standard input or in each file, and their total if there are several
+ * files. The files and the chunks of the large ones are counted on several threads.
  *
  * This is the executor for builtin command `wc`.
+ *
+ * @see wc(1)
  */
-class TWcExecutor final : public TDetachedExecutorBase {
+class TWcExecutor final : public TInProcessExecutorBase {
 public:
     /**
      * Creates the executor.
@@ -195,7 +199,7 @@ public:
     /**
      * Executes the command.
      */
-    int ExecuteChild(const TCommand& command, TCmdEnvironment& env) override;
+    int Run(const TCommand& command, TCmdEnvironment& env, std::istream& in, std::ostream& out) override;
 };
 
 /**
@@ -203,7 +207,7 @@ public:
  *
  * @see grep(1)
  */
-class TGrepExecutor final : public TDetachedExecutorBase {
+class TGrepExecutor final : public TInProcessExecutorBase {
 public:
     explicit TGrepExecutor(TEnvironment& globalEnvironment);
 
@@ -220,7 +224,7 @@ public:
     /**
      * Executes the command
      */
-     int ExecuteChild(const TCommand& command, TCmdEnvironment& env) override;
+     int Run(const TCommand& command, TCmdEnvironment& env, std::istream& in, std::ostream& out) override;
 };
 
 /**
@@ -279,5 +283,37 @@ private:
     TEnvironment& Environment_;
 };
 
+/**
+ * Shows and manages the locations of external commands remembered by {@link NCli::NPrivate::TCommandHashTable}.
+ *
+ * Without arguments, prints the remembered commands with their hit counts. `hash -r` forgets all of them, `hash -s`
+ * prints the number of lookups answered from the table and of lookups which had to search $PATH, and
+ * `hash name...` searches the names in $PATH and remembers them.
+ *
+ * This is the executor for builtin command `hash`.
+ */
+class THashExecutor final : public IExecutor {
+public:
+    explicit THashExecutor(TEnvironment& globalEnvironment);
+
+    /**
+     * It is supposed that all executors are wrapped in std::shared_ptr. Every executor is not copy-constructible nor
+     * -assignable nor move-constructible nor -assignable in order to ensure no illegal action is performed.
+     */
+    ~THashExecutor() override = default;
+    THashExecutor(const THashExecutor&) = delete;
+    THashExecutor& operator=(const THashExecutor&) = delete;
+    THashExecutor(THashExecutor&&) noexcept = delete;
+    THashExecutor& operator=(THashExecutor&&) = delete;
+
+    /**
+     * {@link NCli::IExecutor::Execute}
+     */
+    void Execute(const TCommand& command, IIStreamWrapper&, std::ostream& os) override;
+
+private:
+    TEnvironment& Environment_;
+};
+
 } // namespace NPrivate
 } // namespace NCli
\ No newline at end of file
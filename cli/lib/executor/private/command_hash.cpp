@@ -0,0 +1,162 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "command_hash.h"
+
+#include <tokenizer/tokenize_dfa.h>
+
+#include <algorithm>
+#include <filesystem>
+
+namespace NCli {
+namespace NPrivate {
+namespace {
+
+std::vector<std::string> SplitPath(const std::string& path) {
+    TTokenizeDFA pathParser;
+    TTokenizeDFA::TState* zero = pathParser.ZeroState();
+    TTokenizeDFA::TState* escape = pathParser.MakeState();
+    zero->SetCallback(
+            [escape](char c, TTokenizeDFA::TExecCallback& cb) {
+                if (c == '\\') {
+                    cb.PushState(escape);
+                } else if (c == ':') {
+                    if (cb.TokenStarted()) {
+                        cb.EndToken();
+                    }
+                    cb.StartToken();
+                } else {
+                    cb.PushCharacter(TExtChar(c));
+                }
+            }
+    );
+    escape->SetCallback(
+            [](char c, TTokenizeDFA::TExecCallback& cb) {
+                cb.PushCharacter(TExtChar(c, ECharEscapeStatus::ESCAPED));
+                cb.PopState();
+            }
+    );
+
+    pathParser.Update(":" + path + ":");
+
+    std::vector<std::string> directories;
+    for (const TToken& directory : pathParser.ParsedTokens()) {
+        directories.push_back(directory.ToString());
+    }
+    return directories;
+}
+
+std::optional<std::string> SearchDirectories(const std::vector<std::string>& directories, const std::string& command) {
+    namespace fs = std::filesystem;
+
+    for (const std::string& directory : directories) {
+        fs::path check = fs::path(directory) / fs::path(command);
+        std::error_code error;
+        if (fs::exists(check, error)) {
+            return check.string();
+        }
+    }
+    return {};
+}
+
+} // namespace <anonymous>
+
+TCommandHashTable& TCommandHashTable::Instance() {
+    static TCommandHashTable table;
+    return table;
+}
+
+std::optional<std::string> TCommandHashTable::Find(const std::string& path, const std::string& command) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Bind(path);
+
+    auto it = Entries_.find(command);
+    if (it != Entries_.end()) {
+        Hits_++;
+        it->second.Hits++;
+        return it->second.Path;
+    }
+
+    Misses_++;
+    auto location = SearchBound(command);
+    if (location.has_value()) {
+        Entries_[command] = TEntry{location.value(), 0};
+    }
+    return location;
+}
+
+std::optional<std::string> TCommandHashTable::Search(const std::string& path, const std::string& command) {
+    return SearchDirectories(SplitPath(path), command);
+}
+
+bool TCommandHashTable::Add(const std::string& path, const std::string& command) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Bind(path);
+
+    auto location = SearchBound(command);
+    if (!location.has_value()) {
+        Entries_.erase(command);
+        return false;
+    }
+    Entries_[command] = TEntry{location.value(), 0};
+    return true;
+}
+
+void TCommandHashTable::Forget(const std::string& command) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Entries_.erase(command);
+}
+
+void TCommandHashTable::Clear() {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Entries_.clear();
+}
+
+std::vector<std::pair<std::string, TCommandHashTable::TEntry>> TCommandHashTable::Entries() const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    std::vector<std::pair<std::string, TEntry>> entries(Entries_.begin(), Entries_.end());
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; }
+    );
+    return entries;
+}
+
+std::size_t TCommandHashTable::Hits() const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Hits_;
+}
+
+std::size_t TCommandHashTable::Misses() const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Misses_;
+}
+
+void TCommandHashTable::Bind(const std::string& path) {
+    if (Bound_ && path == Path_) {
+        return;
+    }
+    Bound_ = true;
+    Path_ = path;
+    Directories_ = SplitPath(path);
+    Entries_.clear();
+}
+
+std::optional<std::string> TCommandHashTable::SearchBound(const std::string& command) const {
+    return SearchDirectories(Directories_, command);
+}
+
+} // namespace NPrivate
+} // namespace NCli
@@ -0,0 +1,128 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace NCli {
+namespace NPrivate {
+
+/**
+ * Remembers where the external commands have been found in $PATH, like the hash table of bash.
+ *
+ * The table is shared by the whole session. It is bound to the value of $PATH it was filled with: a lookup with
+ * another value of $PATH (after an assignment) drops all the entries, so a stale location is never used. A command
+ * run with $PATH assigned for it only is searched with {@link NCli::NPrivate::TCommandHashTable::Search} and does not
+ * touch the table.
+ */
+class TCommandHashTable final {
+public:
+    /**
+     * A remembered location of a command.
+     */
+    struct TEntry {
+        /**
+         * Full path to the executable.
+         */
+        std::string Path;
+
+        /**
+         * Number of times the location was taken from the table.
+         */
+        std::size_t Hits = 0;
+    };
+
+    /**
+     * Returns the table of the session.
+     */
+    static TCommandHashTable& Instance();
+
+    TCommandHashTable() = default;
+    ~TCommandHashTable() = default;
+    TCommandHashTable(const TCommandHashTable&) = delete;
+    TCommandHashTable& operator=(const TCommandHashTable&) = delete;
+    TCommandHashTable(TCommandHashTable&&) noexcept = delete;
+    TCommandHashTable& operator=(TCommandHashTable&&) noexcept = delete;
+
+    /**
+     * Returns the location of {@arg command} in {@arg path}, which is the value of $PATH. Searches the directories
+     * only if the command is not in the table yet.
+     *
+     * @return Empty if the command is not found.
+     */
+    std::optional<std::string> Find(const std::string& path, const std::string& command);
+
+    /**
+     * Searches for {@arg command} in {@arg path} without looking at the table or changing it.
+     *
+     * @return Empty if the command is not found.
+     */
+    static std::optional<std::string> Search(const std::string& path, const std::string& command);
+
+    /**
+     * Searches for {@arg command} in {@arg path} even if it is in the table and remembers the location.
+     *
+     * @return false if the command is not found.
+     */
+    bool Add(const std::string& path, const std::string& command);
+
+    /**
+     * Drops the entry of {@arg command}, for example, when its executable has disappeared.
+     */
+    void Forget(const std::string& command);
+
+    /**
+     * Drops all the entries. The hit and miss counters are kept.
+     */
+    void Clear();
+
+    /**
+     * Returns the entries sorted by command name.
+     */
+    std::vector<std::pair<std::string, TEntry>> Entries() const;
+
+    /**
+     * Returns the number of lookups answered from the table.
+     */
+    std::size_t Hits() const;
+
+    /**
+     * Returns the number of lookups which had to search $PATH.
+     */
+    std::size_t Misses() const;
+
+private:
+    void Bind(const std::string& path);
+    std::optional<std::string> SearchBound(const std::string& command) const;
+
+    mutable std::mutex Mutex_;
+    bool Bound_ = false;
+    std::string Path_;
+    std::vector<std::string> Directories_;
+    std::unordered_map<std::string, TEntry> Entries_;
+    std::size_t Hits_ = 0;
+    std::size_t Misses_ = 0;
+};
+
+} // namespace NPrivate
+} // namespace NCli
@@ -16,10 +16,14 @@
 
 #include "detached_executor_base.h"
 
-#include <cstring>
+#include <common/io_pump.h>
+
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
 #include <system_error>
 
+#include <fcntl.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -28,61 +32,114 @@ namespace NPrivate {
 namespace {
 
 void ThrowSystemError() {
-    throw std::system_error(0, std::system_category());
+    throw std::system_error(errno, std::system_category());
+}
+
+/**
+ * Makes {@arg fd} the descriptor {@arg target} of the child. The pipes are opened with O_CLOEXEC, which dup2(2) clears
+ * on the copy, but not when the descriptor already is the target.
+ */
+void Redirect(int fd, int target) {
+    if (fd == target) {
+        if (fcntl(fd, F_SETFD, 0) == -1) {
+            ThrowSystemError();
+        }
+    } else if (dup2(fd, target) == -1) {
+        ThrowSystemError();
+    }
 }
 
 } // namespace <anonymous>
 
+std::size_t PipeCapacity(const TEnvironment& environment) {
+    const std::string* value = environment.Find("CLI_PIPE_SIZE");
+    if (value != nullptr) {
+        char* end = nullptr;
+        unsigned long long capacity = std::strtoull(value->c_str(), &end, 10);
+        if (!value->empty() && *end == '\0' && capacity != 0) {
+            return capacity;
+        }
+    }
+    return DEFAULT_PIPE_CAPACITY;
+}
+
 TDetachedExecutorBase::TDetachedExecutorBase(TEnvironment& globalEnvironment)
     : GlobalEnvironment_(globalEnvironment)
 { }
 
 void TDetachedExecutorBase::Execute(const NCli::TCommand& command, NCli::IIStreamWrapper& in, std::ostream& out) {
+    TBrokenPipeSignalGuard ignoreBrokenPipes;
+
+    TPipe childStdin;
+    TPipe childStdout;
+    childStdin.SetCapacity(PipeCapacity(GlobalEnvironment_));
+    childStdout.SetCapacity(PipeCapacity(GlobalEnvironment_));
+
+    TChildRedirections redirections;
+    if (in.IsPiped()) {
+        redirections.Stdin = childStdin.ReadEndDescriptor();
+    }
+    redirections.Stdout = childStdout.WriteEndDescriptor();
+    for (const TPipe* pipe : {&childStdin, &childStdout}) {
+        for (int fd : pipe->OpenDescriptors()) {
+            redirections.Close.push_back(fd);
+        }
+    }
+
+    pid_t pid = Spawn(command, redirections);
+
+    childStdin.RegisterDirection(TPipe::EDirection::OUT);
+    childStdout.RegisterDirection(TPipe::EDirection::IN);
+
+    try {
+        TIOPump(in, childStdin, childStdout, out).Run();
+    } catch (...) {
+        waitpid(pid, nullptr, 0);
+        throw;
+    }
+
+    waitpid(pid, nullptr, 0);
+}
+
+pid_t TDetachedExecutorBase::Spawn(const TCommand& command, const TChildRedirections& redirections) {
     TCmdEnvironment cmdEnv(GlobalEnvironment_);
     UpdateCmdEnvironment(cmdEnv, command);
 
     PreExec(cmdEnv, command);
 
-    TPipe childStdin;
-    TPipe childStdout;
+    return Launch(command, cmdEnv, redirections);
+}
 
+pid_t TDetachedExecutorBase::Launch(const TCommand& command, TCmdEnvironment& env,
+                                    const TChildRedirections& redirections) {
     pid_t pid = fork();
     if (pid < 0) {
         ThrowSystemError();
     } else if (pid == 0) {
         // child
 
-        childStdin.RegisterDirection(TPipe::EDirection::IN);
-        if (in.Dup(childStdin.ReadEndDescriptor(), STDIN_FILENO) == -1) {
-            ThrowSystemError();
+        int exitCode;
+        try {
+            RestoreBrokenPipeSignal();
+            if (redirections.Stdin != -1) {
+                Redirect(redirections.Stdin, STDIN_FILENO);
+            }
+            Redirect(redirections.Stdout, STDOUT_FILENO);
+            for (int fd : redirections.Close) {
+                if (fd != STDIN_FILENO && fd != STDOUT_FILENO) {
+                    close(fd);
+                }
+            }
+            exitCode = ExecuteChild(command, env);
+        } catch (std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            exitCode = 1;
         }
-
-        childStdout.RegisterDirection(TPipe::EDirection::OUT);
-        if (dup2(childStdout.WriteEndDescriptor(), STDOUT_FILENO) == -1) {
-            ThrowSystemError();
-        }
-
-        exit(ExecuteChild(command, cmdEnv));
-    } else {
-        // parent
-
-        childStdin.RegisterDirection(TPipe::EDirection::OUT);
-        childStdout.RegisterDirection(TPipe::EDirection::IN);
-
-        in.CopyContentToFile(childStdin.WriteEndDescriptor());
-        childStdin.CloseWriteEnd();
-
-        waitpid(pid, nullptr, 0);
-
-        char buf[128];
-        std::memset(buf, 0, sizeof(buf));
-        ssize_t status;
-        do {
-            out << buf;
-            status = read(childStdout.ReadEndDescriptor(), buf, sizeof(buf));
-            buf[status] = 0;
-        } while (status != 0);
+        std::cout.flush();
+        _exit(exitCode);
     }
+
+    return pid;
 }
 
 void TDetachedExecutorBase::PreExec(TCmdEnvironment& cmdEnv, const TCommand& command) { }
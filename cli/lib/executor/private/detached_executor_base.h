@@ -19,16 +19,57 @@
 #include <common/pipe.h>
 #include <executor/executor.h>
 
+#include <cstddef>
 #include <memory>
+#include <vector>
+
+#include <sys/types.h>
 
 namespace NCli {
 namespace NPrivate {
 
+/**
+ * Describes how the standard streams of a child process are set up.
+ */
+struct TChildRedirections {
+    /**
+     * Descriptor to become the child stdin, or -1 to inherit the shell stdin.
+     */
+    int Stdin = -1;
+
+    /**
+     * Descriptor to become the child stdout.
+     */
+    int Stdout = -1;
+
+    /**
+     * Descriptors to be closed in the child after the redirections are made, for example, the pipes of the other
+     * stages of a pipeline. Otherwise the readers of those pipes would never reach EOF. The pipes are opened with
+     * O_CLOEXEC, so a child executing another program does not have to close them itself.
+     */
+    std::vector<int> Close;
+};
+
+/**
+ * Returns the capacity to be requested for the pipes connecting the shell with the commands it runs: the value of
+ * CLI_PIPE_SIZE in bytes if it is set to a positive number, or {@link NCli::NPrivate::DEFAULT_PIPE_CAPACITY}.
+ *
+ * @see NCli::TPipe::SetCapacity
+ */
+std::size_t PipeCapacity(const TEnvironment& environment);
+
+/**
+ * The pipe capacity used unless CLI_PIPE_SIZE is set. It is larger than the default of Linux, so the stages of a
+ * high-volume pipeline exchange data in fewer system calls and context switches.
+ */
+constexpr std::size_t DEFAULT_PIPE_CAPACITY = 1 << 18;
+
 /**
  * This is a base class for executors which have to be executed in a separate process.
  *
- * All external commands have to be executed in separate processes. Also, every executor which is reading something
- * from stdin should be executed in separate process because std::cin may become inconsistent after receiving EOF.
+ * Only external commands and the built-ins wrapped in {@link NCli::NPrivate::TForkedExecutor} use this base. The
+ * built-ins reading their input run in the shell process itself, see
+ * {@link NCli::NPrivate::TInProcessExecutorBase}.
  */
 class TDetachedExecutorBase : public IExecutor {
 public:
@@ -50,9 +91,21 @@ public:
     /**
      * Calls {@link NCli::NPrivate::TDetachedExecutor::PreExec}, creates a separate process, handles stdin and stdout
      * correctly and calls {@link NCli::NPrivate::TDetachedExecutor::ExecuteChild} in it.
+     *
+     * The input is fed and the output is drained simultaneously by {@link NCli::TIOPump}, and the child is waited
+     * for only after its output is over.
      */
     void Execute(const TCommand& command, IIStreamWrapper& in, std::ostream& out) final;
 
+    /**
+     * Calls {@link NCli::NPrivate::TDetachedExecutor::PreExec} and creates a separate process with the standard streams
+     * set up according to {@arg redirections}, without waiting for it. This is used to run the stages of a pipeline
+     * simultaneously.
+     *
+     * @return Process id of the child, which must be waited for by the caller.
+     */
+    pid_t Spawn(const TCommand& command, const TChildRedirections& redirections);
+
     /**
      * This is called before creating child process.
      */
@@ -67,6 +120,17 @@ public:
      */
     virtual int ExecuteChild(const TCommand& command, TCmdEnvironment& env) = 0;
 
+protected:
+    /**
+     * Creates the child process. This is called after {@link NCli::NPrivate::TDetachedExecutor::PreExec}.
+     *
+     * The default implementation forks, makes the redirections and calls
+     * {@link NCli::NPrivate::TDetachedExecutor::ExecuteChild} in the child.
+     *
+     * @return Process id of the child.
+     */
+    virtual pid_t Launch(const TCommand& command, TCmdEnvironment& env, const TChildRedirections& redirections);
+
 private:
     TEnvironment& GlobalEnvironment_;
 };
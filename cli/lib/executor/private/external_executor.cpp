@@ -17,14 +17,18 @@
 #include "external_executor.h"
 
 #include <common/pipe.h>
-#include <tokenizer/tokenize_dfa.h>
+#include <executor/private/command_hash.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <csignal>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <system_error>
+#include <vector>
 
+#include <spawn.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -32,52 +36,70 @@ namespace NCli {
 namespace NPrivate {
 namespace {
 
-void ThrowSystemError() {
-    throw std::system_error(0, std::system_category());
+void ThrowSystemError(int error = errno) {
+    throw std::system_error(error, std::system_category());
 }
 
-std::string FindPath(TCmdEnvironment& cmdEnv, const std::string& command) {
-    namespace fs = std::filesystem;
+/**
+ * Builds a null-terminated array of pointers to the given strings, as expected by execve and posix_spawn for the
+ * arguments.
+ */
+std::vector<char*> ToCStringArray(const std::vector<std::string>& strings) {
+    std::vector<char*> result;
+    result.reserve(strings.size() + 1);
+    std::transform(strings.begin(), strings.end(), std::back_inserter(result),
+                   [](const std::string& s) { return const_cast<char*>(s.c_str()); }
+    );
+    result.push_back(nullptr);
+    return result;
+}
 
-    if (fs::exists(fs::path(command))) {
-        return command;
+/**
+ * RAII holder for posix_spawn file actions and attributes.
+ */
+class TSpawnSetup {
+public:
+    TSpawnSetup() {
+        posix_spawn_file_actions_init(&Actions_);
+        posix_spawnattr_init(&Attr_);
     }
 
-    TTokenizeDFA pathParser;
-    TTokenizeDFA::TState* zero = pathParser.ZeroState();
-    TTokenizeDFA::TState* escape = pathParser.MakeState();
-    zero->SetCallback(
-            [escape](char c, TTokenizeDFA::TExecCallback& cb) {
-                if (c == '\\') {
-                    cb.PushState(escape);
-                } else if (c == ':') {
-                    if (cb.TokenStarted()) {
-                        cb.EndToken();
-                    }
-                    cb.StartToken();
-                } else {
-                    cb.PushCharacter(TExtChar(c));
-                }
-            }
-    );
-    escape->SetCallback(
-            [](char c, TTokenizeDFA::TExecCallback& cb) {
-                cb.PushCharacter(TExtChar(c, ECharEscapeStatus::ESCAPED));
-                cb.PopState();
-            }
-    );
+    ~TSpawnSetup() {
+        posix_spawn_file_actions_destroy(&Actions_);
+        posix_spawnattr_destroy(&Attr_);
+    }
 
-    std::string path = cmdEnv.GetValue("PATH");
-    pathParser.Update(":" + path + ":");
+    TSpawnSetup(const TSpawnSetup&) = delete;
+    TSpawnSetup& operator=(const TSpawnSetup&) = delete;
+
+    posix_spawn_file_actions_t* Actions() {
+        return &Actions_;
+    }
 
-    for (const TToken& searchPath : pathParser.ParsedTokens()) {
-        fs::path check = fs::path(searchPath.ToString()) / fs::path(command);
-        if (fs::exists(check)) {
-            return check;
-        }
+    posix_spawnattr_t* Attr() {
+        return &Attr_;
+    }
+
+private:
+    posix_spawn_file_actions_t Actions_;
+    posix_spawnattr_t Attr_;
+};
+
+std::string FindPath(TCmdEnvironment& cmdEnv, const std::string& command) {
+    // The command is looked for relative to the current directory first. Only the locations found in $PATH are
+    // remembered.
+    if (std::filesystem::exists(std::filesystem::path(command))) {
+        return command;
     }
 
-    throw TCommandNotFoundException(command);
+    // The table stays bound to the $PATH of the session when a command is run with its own $PATH.
+    const std::string& path = cmdEnv.GetValue("PATH");
+    auto location = cmdEnv.IsLocal("PATH") ? TCommandHashTable::Search(path, command)
+                                           : TCommandHashTable::Instance().Find(path, command);
+    if (!location.has_value()) {
+        throw TCommandNotFoundException(command);
+    }
+    return location.value();
 }
 
 } // namespace <anonymous>
@@ -87,27 +109,55 @@ TExternalExecutor::TExternalExecutor(TEnvironment& globalEnv)
 {}
 
 int TExternalExecutor::ExecuteChild(const TCommand& command, TCmdEnvironment& env) {
-    char* argv[command.Args().size() + 1];
-    std::transform(command.Args().begin(), command.Args().end(), argv,
-                   [](const std::string& s) { return const_cast<char*>(s.c_str()); }
-    );
-    argv[command.Args().size()] = nullptr;
-
-    auto environment = env.ToEnvP();
+    std::vector<char*> argv = ToCStringArray(command.Args());
+    auto envp = env.EnvP();
 
-    char* envp[environment.size() + 1];
-    std::transform(environment.begin(), environment.end(), envp,
-                   [](const std::string& s) { return const_cast<char*>(s.c_str()); }
-    );
-    envp[environment.size()] = nullptr;
-
-    if (execve(CmdPath_.c_str(), argv, envp) == -1) {
+    if (execve(CmdPath_.c_str(), argv.data(), envp.Get()) == -1) {
         ThrowSystemError();
     }
 
     return 0; // Unreachable
 }
 
+pid_t TExternalExecutor::Launch(const TCommand& command, TCmdEnvironment& env,
+                                const TChildRedirections& redirections) {
+    if (env.GetValue("CLI_SPAWN_METHOD") == "fork") {
+        return TDetachedExecutorBase::Launch(command, env, redirections);
+    }
+
+    TSpawnSetup setup;
+    int error = 0;
+    if (redirections.Stdin != -1) {
+        error = error ? error : posix_spawn_file_actions_adddup2(setup.Actions(), redirections.Stdin, STDIN_FILENO);
+    }
+    error = error ? error : posix_spawn_file_actions_adddup2(setup.Actions(), redirections.Stdout, STDOUT_FILENO);
+    // The descriptors of redirections.Close are the pipes, which are opened with O_CLOEXEC and closed by the exec.
+
+    // The shell ignores SIGPIPE; the child must get the default disposition back.
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    error = error ? error : posix_spawnattr_setsigdefault(setup.Attr(), &defaultSignals);
+    error = error ? error : posix_spawnattr_setflags(setup.Attr(), POSIX_SPAWN_SETSIGDEF);
+    if (error) {
+        ThrowSystemError(error);
+    }
+
+    std::vector<char*> argv = ToCStringArray(command.Args());
+    auto envp = env.EnvP();
+
+    pid_t pid;
+    error = posix_spawn(&pid, CmdPath_.c_str(), setup.Actions(), setup.Attr(), argv.data(), envp.Get());
+    if (error == ENOENT) {
+        // The remembered executable has disappeared; look it up again next time.
+        TCommandHashTable::Instance().Forget(command.Command());
+    }
+    if (error) {
+        ThrowSystemError(error);
+    }
+    return pid;
+}
+
 void TExternalExecutor::PreExec(TCmdEnvironment& cmdEnv, const TCommand& command) {
     CmdPath_ = FindPath(cmdEnv, command.Command());
 }
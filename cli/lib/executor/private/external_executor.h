@@ -25,6 +25,10 @@ namespace NPrivate {
  * Executes an external command.
  *
  * Searches $PATH for an executable name, then does the actual execution.
+ *
+ * The child is created with posix_spawn, which lets the C library use vfork or clone(CLONE_VM) instead of copying the
+ * page tables of the shell. Setting CLI_SPAWN_METHOD=fork in the environment of the command falls back to the generic
+ * fork-and-exec path of {@link NCli::NPrivate::TDetachedExecutorBase}.
  */
 class TExternalExecutor final : public TDetachedExecutorBase {
 public:
@@ -53,6 +57,12 @@ public:
      */
     int ExecuteChild(const TCommand& command, TCmdEnvironment& env) override;
 
+protected:
+    /**
+     * Spawns the command with posix_spawn unless fork is requested with CLI_SPAWN_METHOD.
+     */
+    pid_t Launch(const TCommand& command, TCmdEnvironment& env, const TChildRedirections& redirections) override;
+
 private:
     std::string CmdPath_;
 };
@@ -0,0 +1,463 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "grep_matcher.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define CLI_GREP_MATCHER_X86
+#endif
+
+namespace NCli {
+namespace NPrivate {
+namespace {
+
+/**
+ * The characters special in the basic regular expressions, as std::regex understands them, and the newline, which
+ * separates alternatives in grep syntax.
+ */
+constexpr std::string_view SPECIAL_CHARACTERS = ".[\\*^$\n";
+
+constexpr int NOT_LITERAL = -1;
+
+const std::array<unsigned char, 256>& FoldTable() {
+    static const std::array<unsigned char, 256> table = []() {
+        std::array<unsigned char, 256> ret{};
+        for (std::size_t c = 0; c != ret.size(); c++) {
+            ret[c] = static_cast<unsigned char>(std::tolower(static_cast<int>(c)));
+        }
+        return ret;
+    }();
+    return table;
+}
+
+/**
+ * Returns whether the {@arg size} bytes at {@arg data} are equal to the folded {@arg needle} ignoring case.
+ */
+bool EqualFolded(const unsigned char* data, const unsigned char* needle, std::size_t size) {
+    const auto& fold = FoldTable();
+    for (std::size_t i = 0; i != size; i++) {
+        if (fold[data[i]] != needle[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Looks for the folded {@arg needle} ignoring case with the Boyer-Moore-Horspool algorithm. The shifts are indexed by
+ * folded characters.
+ */
+std::size_t HorspoolFindFolded(const unsigned char* data, std::size_t size, std::size_t from, std::string_view needle,
+                               const std::array<std::size_t, 256>& shift) {
+    const auto& fold = FoldTable();
+    const auto* folded = reinterpret_cast<const unsigned char*>(needle.data());
+    std::size_t length = needle.size();
+    for (std::size_t pos = from; pos + length <= size;) {
+        unsigned char last = fold[data[pos + length - 1]];
+        if (last == folded[length - 1] && EqualFolded(data + pos, folded, length - 1)) {
+            return pos;
+        }
+        pos += shift[last];
+    }
+    return std::string_view::npos;
+}
+
+#ifdef CLI_GREP_MATCHER_X86
+
+/**
+ * Looks for the folded {@arg needle} ignoring case, 16 positions at a time: a position is a candidate when both its
+ * first and last characters are equal to the ones of the needle in either case.
+ *
+ * @return The position of the occurrence or npos. The first position left unchecked, as there are not enough bytes
+ * for a vector after it, is stored to {@arg checked}.
+ */
+std::size_t Sse2FindFolded(const unsigned char* data, std::size_t size, std::size_t from, std::string_view needle,
+                           std::size_t& checked) {
+    const auto* folded = reinterpret_cast<const unsigned char*>(needle.data());
+    std::size_t length = needle.size();
+    auto upper = [](unsigned char c) {
+        return static_cast<char>(std::toupper(c));
+    };
+    const __m128i firstLower = _mm_set1_epi8(static_cast<char>(folded[0]));
+    const __m128i firstUpper = _mm_set1_epi8(upper(folded[0]));
+    const __m128i lastLower = _mm_set1_epi8(static_cast<char>(folded[length - 1]));
+    const __m128i lastUpper = _mm_set1_epi8(upper(folded[length - 1]));
+
+    std::size_t pos = from;
+    for (; pos + length - 1 + 16 <= size; pos += 16) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + length - 1));
+        __m128i candidates = _mm_and_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(first, firstLower), _mm_cmpeq_epi8(first, firstUpper)),
+            _mm_or_si128(_mm_cmpeq_epi8(last, lastLower), _mm_cmpeq_epi8(last, lastUpper)));
+        for (auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(candidates)); bits != 0; bits &= bits - 1) {
+            std::size_t candidate = pos + __builtin_ctz(bits);
+            if (EqualFolded(data + candidate + 1, folded + 1, length - 1)) {
+                return candidate;
+            }
+        }
+    }
+    checked = pos;
+    return std::string_view::npos;
+}
+
+#endif // CLI_GREP_MATCHER_X86
+
+/**
+ * Returns the position after the bracket expression starting at {@arg i}, or npos if it is not terminated.
+ */
+std::size_t SkipBracket(std::string_view pattern, std::size_t i) {
+    std::size_t j = i + 1;
+    if (j < pattern.size() && pattern[j] == '^') {
+        j++;
+    }
+    if (j < pattern.size() && pattern[j] == ']') {
+        j++;
+    }
+    while (j < pattern.size()) {
+        if (pattern[j] == '[' && j + 1 < pattern.size() && std::strchr(":.=", pattern[j + 1]) != nullptr) {
+            const char terminator[] = {pattern[j + 1], ']', '\0'};
+            std::size_t end = pattern.find(terminator, j + 2);
+            if (end == std::string_view::npos) {
+                return std::string_view::npos;
+            }
+            j = end + 2;
+        } else if (pattern[j] == ']') {
+            return j + 1;
+        } else {
+            j++;
+        }
+    }
+    return std::string_view::npos;
+}
+
+/**
+ * Returns the position after the group starting at {@arg i}, or npos if it is not terminated.
+ */
+std::size_t SkipGroup(std::string_view pattern, std::size_t i) {
+    std::size_t depth = 0;
+    std::size_t j = i;
+    while (j < pattern.size()) {
+        if (pattern[j] == '[') {
+            j = SkipBracket(pattern, j);
+            if (j == std::string_view::npos) {
+                return j;
+            }
+        } else if (pattern[j] == '\\' && j + 1 < pattern.size()) {
+            if (pattern[j + 1] == '(') {
+                depth++;
+            } else if (pattern[j + 1] == ')' && --depth == 0) {
+                return j + 2;
+            }
+            j += 2;
+        } else {
+            j++;
+        }
+    }
+    return std::string_view::npos;
+}
+
+/**
+ * Returns the longest run of characters which every match of the basic regular expression contains, or an empty
+ * string if there is no such run or the pattern uses a construction which is not understood here.
+ */
+std::string RequiredLiteral(std::string_view pattern) {
+    // Every atom is either a literal character or not. A quantified atom may be absent, so it is not literal.
+    std::vector<int> atoms;
+    auto quantify = [&atoms]() {
+        if (atoms.empty()) {
+            return false;
+        }
+        atoms.back() = NOT_LITERAL;
+        return true;
+    };
+
+    for (std::size_t i = 0; i < pattern.size();) {
+        char c = pattern[i];
+        if (c == '\n') {
+            return std::string();
+        } else if (c == '^') {
+            if (i != 0) {
+                return std::string();
+            }
+            i++;
+        } else if (c == '$') {
+            if (i + 1 != pattern.size()) {
+                return std::string();
+            }
+            i++;
+        } else if (c == '.') {
+            atoms.push_back(NOT_LITERAL);
+            i++;
+        } else if (c == '*') {
+            if (!quantify()) {
+                return std::string();
+            }
+            i++;
+        } else if (c == '[') {
+            i = SkipBracket(pattern, i);
+            if (i == std::string_view::npos) {
+                return std::string();
+            }
+            atoms.push_back(NOT_LITERAL);
+        } else if (c == '\\') {
+            if (i + 1 == pattern.size()) {
+                return std::string();
+            }
+            char escaped = pattern[i + 1];
+            if (escaped == '(') {
+                i = SkipGroup(pattern, i);
+                if (i == std::string_view::npos) {
+                    return std::string();
+                }
+                atoms.push_back(NOT_LITERAL);
+            } else if (escaped == '{') {
+                std::size_t end = pattern.find("\\}", i + 2);
+                if (end == std::string_view::npos || !quantify()) {
+                    return std::string();
+                }
+                i = end + 2;
+            } else if (escaped >= '1' && escaped <= '9') {
+                atoms.push_back(NOT_LITERAL);
+                i += 2;
+            } else if (escaped != '\n' && SPECIAL_CHARACTERS.find(escaped) != std::string_view::npos) {
+                atoms.push_back(static_cast<unsigned char>(escaped));
+                i += 2;
+            } else {
+                return std::string();
+            }
+        } else {
+            atoms.push_back(static_cast<unsigned char>(c));
+            i++;
+        }
+    }
+
+    std::string longest;
+    std::string run;
+    for (int atom : atoms) {
+        if (atom == NOT_LITERAL) {
+            run.clear();
+        } else {
+            run.push_back(static_cast<char>(atom));
+            if (run.size() > longest.size()) {
+                longest = run;
+            }
+        }
+    }
+    return longest;
+}
+
+/**
+ * Returns whether the pattern without the anchors, which are given by {@arg atStart} and {@arg atEnd}, is a literal.
+ * The literal is stored to {@arg literal}.
+ */
+bool IsAnchoredLiteral(std::string_view pattern, bool& atStart, bool& atEnd, std::string& literal) {
+    atStart = !pattern.empty() && pattern.front() == '^';
+    if (atStart) {
+        pattern.remove_prefix(1);
+    }
+    // A '$' escaped by a backslash is not an anchor, but the backslash makes the rest not a literal anyway.
+    atEnd = !pattern.empty() && pattern.back() == '$';
+    if (atEnd) {
+        pattern.remove_suffix(1);
+    }
+    if (!(atStart || atEnd) || pattern.empty() || pattern.find_first_of(SPECIAL_CHARACTERS) != std::string_view::npos) {
+        return false;
+    }
+    literal = pattern;
+    return true;
+}
+
+} // namespace <anonymous>
+
+bool TGrepLineRegexp::LineMatches(const std::regex& pattern, std::string_view line) {
+    return std::regex_search(line.data(), line.data() + line.size(), pattern);
+}
+
+bool TGrepWordRegexp::IsWordConstituentCharacter(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool TGrepWordRegexp::LineMatches(const std::regex& pattern, std::string_view line) {
+    std::cregex_iterator end;
+    for (std::cregex_iterator match(line.data(), line.data() + line.size(), pattern); match != end; match++) {
+        const auto& prefix = match->prefix();
+        if (prefix.length() != 0 && IsWordConstituentCharacter(*(prefix.second - 1))) {
+            continue;
+        }
+        const auto& suffix = match->suffix();
+        if (suffix.length() != 0 && IsWordConstituentCharacter(*suffix.first)) {
+            continue;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+TGrepMatcher::TGrepMatcher(const std::string& pattern, bool ignoreCase, bool wordRegexp)
+    : IgnoreCase_(ignoreCase)
+    , WordRegexp_(wordRegexp)
+{
+    if (!pattern.empty() && pattern.find_first_of(SPECIAL_CHARACTERS) == std::string::npos) {
+        Kind_ = EKind::LITERAL;
+        Needle_ = pattern;
+    } else if (IsAnchoredLiteral(pattern, AtStart_, AtEnd_, Needle_)) {
+        Kind_ = EKind::ANCHORED;
+    } else {
+        auto regexStyle = std::regex_constants::grep;
+        if (ignoreCase) {
+            regexStyle |= std::regex_constants::icase;
+        }
+        Pattern_ = std::regex(pattern, regexStyle);
+        if (wordRegexp) {
+            Strategy_ = std::make_shared<TGrepWordRegexp>();
+        } else {
+            Strategy_ = std::make_shared<TGrepLineRegexp>();
+        }
+        Needle_ = RequiredLiteral(pattern);
+        Kind_ = Needle_.empty() ? EKind::REGEX : EKind::PREFILTERED;
+    }
+
+    if (IgnoreCase_) {
+        const auto& fold = FoldTable();
+        for (char& c : Needle_) {
+            c = static_cast<char>(fold[static_cast<unsigned char>(c)]);
+        }
+        // The Boyer-Moore-Horspool shifts are indexed by folded characters.
+        Shift_.fill(Needle_.size());
+        for (std::size_t i = 0; i + 1 < Needle_.size(); i++) {
+            Shift_[static_cast<unsigned char>(Needle_[i])] = Needle_.size() - 1 - i;
+        }
+    }
+}
+
+std::shared_ptr<const TGrepMatcher> TGrepMatcher::Get(const std::string& pattern, bool ignoreCase, bool wordRegexp) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const TGrepMatcher>> matchers;
+
+    std::string key;
+    key.reserve(pattern.size() + 2);
+    key.push_back(ignoreCase ? 'i' : '-');
+    key.push_back(wordRegexp ? 'w' : '-');
+    key += pattern;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = matchers.find(key);
+    if (it == matchers.end()) {
+        // The pattern is compiled under the lock, so that concurrent stages never compile the same pattern twice.
+        auto matcher = std::make_shared<const TGrepMatcher>(pattern, ignoreCase, wordRegexp);
+        if (matchers.size() >= MAX_CACHED) {
+            matchers.clear();
+        }
+        it = matchers.emplace(std::move(key), std::move(matcher)).first;
+    }
+    return it->second;
+}
+
+bool TGrepMatcher::LineMatches(std::string_view line) const {
+    switch (Kind_) {
+        case EKind::LITERAL:
+            return WordRegexp_ ? WordMatches(line) : FindNeedle(line, 0) != std::string_view::npos;
+        case EKind::ANCHORED:
+            return AnchoredMatches(line);
+        case EKind::PREFILTERED:
+            if (FindNeedle(line, 0) == std::string_view::npos) {
+                return false;
+            }
+            return Strategy_->LineMatches(Pattern_, line);
+        case EKind::REGEX:
+            return Strategy_->LineMatches(Pattern_, line);
+    }
+    return false;
+}
+
+TGrepMatcher::EKind TGrepMatcher::Kind() const {
+    return Kind_;
+}
+
+const std::string& TGrepMatcher::Needle() const {
+    return Needle_;
+}
+
+std::size_t TGrepMatcher::FindNeedle(std::string_view text, std::size_t from) const {
+    std::size_t size = Needle_.size();
+    if (text.size() < from + size) {
+        return std::string_view::npos;
+    }
+
+    if (!IgnoreCase_) {
+        const void* found = memmem(text.data() + from, text.size() - from, Needle_.data(), size);
+        return found != nullptr ? static_cast<const char*>(found) - text.data() : std::string_view::npos;
+    }
+
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    std::size_t pos = from;
+#ifdef CLI_GREP_MATCHER_X86
+    std::size_t found = Sse2FindFolded(data, text.size(), from, Needle_, pos);
+    if (found != std::string_view::npos) {
+        return found;
+    }
+#endif
+    return HorspoolFindFolded(data, text.size(), pos, Needle_, Shift_);
+}
+
+bool TGrepMatcher::WordMatches(std::string_view line) const {
+    // The same as TGrepWordRegexp does: the left side of a match is checked after the end of the previous match only.
+    std::size_t previousEnd = 0;
+    for (std::size_t pos = FindNeedle(line, 0); pos != std::string_view::npos; pos = FindNeedle(line, previousEnd)) {
+        std::size_t end = pos + Needle_.size();
+        bool leftBound = pos == previousEnd || !TGrepWordRegexp::IsWordConstituentCharacter(line[pos - 1]);
+        bool rightBound = end == line.size() || !TGrepWordRegexp::IsWordConstituentCharacter(line[end]);
+        if (leftBound && rightBound) {
+            return true;
+        }
+        previousEnd = end;
+    }
+    return false;
+}
+
+bool TGrepMatcher::AnchoredMatches(std::string_view line) const {
+    std::size_t size = Needle_.size();
+    if (line.size() < size || (AtStart_ && AtEnd_ && line.size() != size)) {
+        return false;
+    }
+    std::size_t pos = AtStart_ ? 0 : line.size() - size;
+    const auto* data = reinterpret_cast<const unsigned char*>(line.data() + pos);
+    const auto* needle = reinterpret_cast<const unsigned char*>(Needle_.data());
+    if (IgnoreCase_ ? !EqualFolded(data, needle, size) : std::memcmp(data, needle, size) != 0) {
+        return false;
+    }
+    if (!WordRegexp_) {
+        return true;
+    }
+    // There is a single possible match, so the characters around it are checked as TGrepWordRegexp does.
+    bool leftBound = pos == 0 || !TGrepWordRegexp::IsWordConstituentCharacter(line[pos - 1]);
+    bool rightBound = pos + size == line.size() || !TGrepWordRegexp::IsWordConstituentCharacter(line[pos + size]);
+    return leftBound && rightBound;
+}
+
+} // namespace NPrivate
+} // namespace NCli
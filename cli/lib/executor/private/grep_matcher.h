@@ -0,0 +1,173 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+
+namespace NCli {
+namespace NPrivate {
+
+/**
+ * This interface represents strategy used to determine whether to select line or not. Currently there are at least two
+ * separate strategies: the default and for word regexs.
+ */
+class IGrepStrategy {
+public:
+    virtual ~IGrepStrategy() = default;
+
+    /**
+     * Returns whether a line should be printed or not.
+     */
+    virtual bool LineMatches(const std::regex& pattern, std::string_view line) = 0;
+};
+
+using TGrepStrategyPtr = std::shared_ptr<IGrepStrategy>;
+
+/**
+ * This represents the default strategy.
+ */
+class TGrepLineRegexp final : public IGrepStrategy {
+public:
+    /**
+     * The line is accepted if it contains a matching substring.
+     */
+    bool LineMatches(const std::regex& pattern, std::string_view line) override;
+};
+
+/**
+ * This represent the whole-word strategy.
+ */
+class TGrepWordRegexp final : public IGrepStrategy {
+public:
+    /**
+     * {@see grep(1)}
+     */
+    static bool IsWordConstituentCharacter(char c);
+
+    /**
+     * The line is accepted if it contains a matching substring that is a whole word. More formally, either line start
+     * or a non-word constituent character must be to the left of the match and the similar condition must satisfy
+     * at the right of the match.
+     *
+     * The matches are looked for one after another, so the left side of a match is checked within the text after the
+     * previous match only: a match right after another one is taken as if it started the line.
+     */
+    bool LineMatches(const std::regex& pattern, std::string_view line) override;
+};
+
+/**
+ * Decides whether the lines match a grep pattern, with the same results as the strategies above give with the
+ * pattern compiled by std::regex in grep syntax, but mostly without running the regular expression.
+ *
+ * The pattern is classified once:
+ * <ul>
+ *     <li>a pattern without special characters is a literal, which is looked for with memmem(3) or, ignoring case,
+ *     with the Boyer-Moore-Horspool algorithm, and the regular expression is not even compiled;</li>
+ *     <li>a literal anchored with '^', '$' or both is only compared with the beginning or the end of the line;</li>
+ *     <li>from another pattern, the longest run of characters every match must contain is extracted, and the regular
+ *     expression only runs on the lines containing it;</li>
+ *     <li>when no such run is found, every line goes to the regular expression.</li>
+ * </ul>
+ */
+class TGrepMatcher final {
+public:
+    /**
+     * How the lines are matched.
+     */
+    enum class EKind {
+        LITERAL,
+        ANCHORED,
+        PREFILTERED,
+        REGEX
+    };
+
+    /**
+     * Compiles the pattern.
+     *
+     * @throws std::regex_error if the pattern is not a valid regular expression.
+     */
+    TGrepMatcher(const std::string& pattern, bool ignoreCase, bool wordRegexp);
+
+    /**
+     * Returns the matcher compiled with the same arguments earlier in this process, or compiles a new one. At most
+     * {@link MAX_CACHED} matchers are kept, all of them are dropped when there are more.
+     *
+     * @throws std::regex_error if the pattern is not a valid regular expression.
+     */
+    static std::shared_ptr<const TGrepMatcher> Get(const std::string& pattern, bool ignoreCase, bool wordRegexp);
+
+    /**
+     * The number of the matchers kept by {@link Get} at most.
+     */
+    static constexpr std::size_t MAX_CACHED = 256;
+
+    /**
+     * The matcher does not change once it is compiled, so it may be shared by reference, but it is not
+     * copy-constructible nor copy-assignable nor move-constructible nor move-assignable.
+     */
+    ~TGrepMatcher() = default;
+    TGrepMatcher(const TGrepMatcher&) = delete;
+    TGrepMatcher& operator=(const TGrepMatcher&) = delete;
+    TGrepMatcher(TGrepMatcher&&) noexcept = delete;
+    TGrepMatcher& operator=(TGrepMatcher&&) noexcept = delete;
+
+    /**
+     * Returns whether the line (without the newline) is selected.
+     */
+    bool LineMatches(std::string_view line) const;
+
+    /**
+     * Returns how the lines are matched.
+     */
+    EKind Kind() const;
+
+    /**
+     * Returns the characters every selected line contains, in lower case if the case is ignored. It is empty when every
+     * line has to be checked.
+     */
+    const std::string& Needle() const;
+
+    /**
+     * Returns the position of the first occurrence of the needle in {@arg text} starting from {@arg from}, or npos.
+     *
+     * The needle never contains a newline, so a text of many lines may be searched at once: only the lines containing
+     * the occurrences may be selected.
+     */
+    std::size_t FindNeedle(std::string_view text, std::size_t from) const;
+
+private:
+    bool WordMatches(std::string_view line) const;
+    bool AnchoredMatches(std::string_view line) const;
+
+    EKind Kind_;
+    bool IgnoreCase_;
+    bool WordRegexp_;
+    bool AtStart_ = false;
+    bool AtEnd_ = false;
+    std::string Needle_;
+    std::array<std::size_t, 256> Shift_{};
+    std::regex Pattern_;
+    TGrepStrategyPtr Strategy_;
+};
+
+} // namespace NPrivate
+} // namespace NCli
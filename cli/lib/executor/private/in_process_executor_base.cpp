@@ -0,0 +1,82 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "in_process_executor_base.h"
+
+#include <common/fd_stream.h>
+#include <common/pipe.h>
+
+#include <iostream>
+
+#include <unistd.h>
+
+namespace NCli {
+namespace NPrivate {
+namespace {
+
+/**
+ * Returns the size of the buffer for a standard stream of a forked child: the capacity of the pipe it is connected
+ * to, or the default size of the stream buffers if it is not a pipe.
+ */
+std::size_t StreamBufferSize(int fd) {
+    std::size_t capacity = TPipe::CapacityOf(fd);
+    return capacity != 0 ? capacity : 1 << 16;
+}
+
+} // namespace <anonymous>
+
+TInProcessExecutorBase::TInProcessExecutorBase(TEnvironment& globalEnvironment)
+    : GlobalEnvironment_(globalEnvironment)
+{}
+
+void TInProcessExecutorBase::Execute(const TCommand& command, IIStreamWrapper& in, std::ostream& out) {
+    RunReportingErrors(command, in.WrappedIStream(), out);
+    in.WrappedIStream().clear();
+}
+
+void TInProcessExecutorBase::RunStage(const TCommand& command, std::istream& in, std::ostream& out) {
+    RunReportingErrors(command, in, out);
+    out.flush();
+}
+
+int TInProcessExecutorBase::RunReportingErrors(const TCommand& command, std::istream& in, std::ostream& out) {
+    try {
+        TCmdEnvironment cmdEnv(GlobalEnvironment_);
+        UpdateCmdEnvironment(cmdEnv, command);
+        return Run(command, cmdEnv, in, out);
+    } catch (std::exception& e) {
+        std::cerr << command.Command() << ": " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << command.Command() << ": unknown error" << std::endl;
+    }
+    return 2;
+}
+
+TForkedExecutor::TForkedExecutor(std::shared_ptr<TInProcessExecutorBase> executor, TEnvironment& globalEnvironment)
+    : TDetachedExecutorBase(globalEnvironment)
+    , Executor_(std::move(executor))
+{}
+
+int TForkedExecutor::ExecuteChild(const TCommand& command, TCmdEnvironment& env) {
+    // The standard streams of the child are read and written in blocks of the pipe capacity, the output is written
+    // before the child exits.
+    TFdIStream in(STDIN_FILENO, StreamBufferSize(STDIN_FILENO));
+    TFdOStream out(STDOUT_FILENO, EFlushPolicy::FULL, StreamBufferSize(STDOUT_FILENO));
+    return Executor_->Run(command, env, in, out);
+}
+
+} // namespace NPrivate
+} // namespace NCli
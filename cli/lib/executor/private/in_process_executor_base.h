@@ -0,0 +1,123 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <executor/executor.h>
+#include <executor/private/detached_executor_base.h>
+
+#include <istream>
+#include <memory>
+#include <ostream>
+
+namespace NCli {
+namespace NPrivate {
+
+/**
+ * This is a base class for built-in executors which read their input but do not need a separate process.
+ *
+ * Such executors read from and write to the given streams, so there is no need to fork the whole shell to run them.
+ * A single command is executed right on the calling thread. A stage of a pipeline is executed on its own thread with
+ * streams backed by the pipe descriptors.
+ */
+class TInProcessExecutorBase : public IExecutor {
+public:
+    /**
+     * Constructs an executor.
+     */
+    explicit TInProcessExecutorBase(TEnvironment& globalEnvironment);
+
+    /**
+     * It is supposed that all executors are wrapped in std::shared_ptr. Every executor is not copy-constructible nor
+     * -assignable nor move-constructible nor -assignable in order to ensure no illegal action is performed.
+     */
+    ~TInProcessExecutorBase() override = default;
+    TInProcessExecutorBase(const TInProcessExecutorBase&) = delete;
+    TInProcessExecutorBase& operator=(const TInProcessExecutorBase&) = delete;
+    TInProcessExecutorBase(TInProcessExecutorBase&&) noexcept = delete;
+    TInProcessExecutorBase& operator=(TInProcessExecutorBase&&) noexcept = delete;
+
+    /**
+     * Calls {@link NCli::NPrivate::TInProcessExecutorBase::Run} on the calling thread, reading from the wrapped input
+     * stream. Errors of any kind are reported to stderr, just like a forked command would fail alone.
+     *
+     * The EOF state of the input stream is cleared afterwards, so the shell may continue to read stdin.
+     */
+    void Execute(const TCommand& command, IIStreamWrapper& in, std::ostream& out) final;
+
+    /**
+     * Executes the command as a stage of a pipeline. This is supposed to be called on a separate thread.
+     *
+     * The input is read from {@arg in} and the output is written and flushed to {@arg out}. Errors of any kind are
+     * reported to stderr instead of being thrown, as an exception escaping a stage thread would terminate the shell.
+     */
+    void RunStage(const TCommand& command, std::istream& in, std::ostream& out);
+
+    /**
+     * Executes the command. It should read from {@arg in} and write to {@arg out}.
+     *
+     * @param command The command to be executed.
+     * @param env Environment in which it is executed.
+     * @return Return status, as in main function.
+     */
+    virtual int Run(const TCommand& command, TCmdEnvironment& env, std::istream& in, std::ostream& out) = 0;
+
+private:
+    /**
+     * Calls {@link NCli::NPrivate::TInProcessExecutorBase::Run} and reports any exception thrown by it to stderr as
+     * "command: error".
+     *
+     * @return Return status of the command, 2 if it has failed with an exception.
+     */
+    int RunReportingErrors(const TCommand& command, std::istream& in, std::ostream& out);
+
+    TEnvironment& GlobalEnvironment_;
+};
+
+/**
+ * Executes an in-process executor in a separate process, the way all the built-ins reading their input were executed
+ * before {@link NCli::NPrivate::TInProcessExecutorBase} was introduced.
+ *
+ * This is not used by the shell itself, but is kept in order to compare both modes.
+ */
+class TForkedExecutor final : public TDetachedExecutorBase {
+public:
+    /**
+     * Creates an executor running {@arg executor} in a child process.
+     */
+    TForkedExecutor(std::shared_ptr<TInProcessExecutorBase> executor, TEnvironment& globalEnvironment);
+
+    /**
+     * It is supposed that all executors are wrapped in std::shared_ptr. Every executor is not copy-constructible nor
+     * -assignable nor move-constructible nor -assignable in order to ensure no illegal action is performed.
+     */
+    ~TForkedExecutor() override = default;
+    TForkedExecutor(const TForkedExecutor&) = delete;
+    TForkedExecutor& operator=(const TForkedExecutor&) = delete;
+    TForkedExecutor(TForkedExecutor&&) noexcept = delete;
+    TForkedExecutor& operator=(TForkedExecutor&&) noexcept = delete;
+
+    /**
+     * Runs the wrapped executor on stdin and stdout.
+     */
+    int ExecuteChild(const TCommand& command, TCmdEnvironment& env) override;
+
+private:
+    std::shared_ptr<TInProcessExecutorBase> Executor_;
+};
+
+} // namespace NPrivate
+} // namespace NCli
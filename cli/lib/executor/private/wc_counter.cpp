@@ -0,0 +1,167 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "wc_counter.h"
+
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define CLI_WC_COUNTER_X86
+#endif
+
+namespace NCli {
+namespace NPrivate {
+namespace {
+
+#ifdef CLI_WC_COUNTER_X86
+
+/**
+ * Returns the masks of the newlines and of the spaces among the 64 bytes at {@arg data}, bit i standing for byte i.
+ */
+void Masks64(const unsigned char* data, std::uint64_t& newlines, std::uint64_t& spaces) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    newlines = 0;
+    spaces = 0;
+    for (int i = 0; i != 4; i++) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i));
+        // '\t', '\n', '\v', '\f' and '\r' are the five characters from '\t' on.
+        __m128i shifted = _mm_sub_epi8(bytes, tab);
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, four), shifted);
+        __m128i isSpace = _mm_or_si128(control, _mm_cmpeq_epi8(bytes, space));
+        newlines |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)))) << (16 * i);
+        spaces |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(isSpace))) << (16 * i);
+    }
+}
+
+/**
+ * Counts the newlines in the whole 64-byte groups from {@arg pos} on and advances {@arg pos} past them.
+ *
+ * Each comparison result, -1 for a newline, is subtracted from per-byte counters, which are summed up with psadbw
+ * before they may overflow.
+ */
+std::uint64_t CountNewlines(const unsigned char* data, std::size_t size, std::size_t& pos) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = zero;
+    while (pos + 64 <= size) {
+        __m128i counters = zero;
+        for (int round = 0; round != 255 && pos + 64 <= size; round++, pos += 64) {
+            for (int i = 0; i != 4; i++) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 16 * i));
+                counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(bytes, newline));
+            }
+        }
+        total = _mm_add_epi64(total, _mm_sad_epu8(counters, zero));
+    }
+    return static_cast<std::uint64_t>(_mm_cvtsi128_si64(total)) +
+           static_cast<std::uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total)));
+}
+
+#endif // CLI_WC_COUNTER_X86
+
+} // namespace <anonymous>
+
+TWcCounter::TWcCounter(bool countWords)
+    : CountWords_(countWords)
+{}
+
+bool TWcCounter::IsSpace(unsigned char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') < 5;
+}
+
+void TWcCounter::Update(std::string_view block) {
+    if (block.empty()) {
+        return;
+    }
+    const auto* data = reinterpret_cast<const unsigned char*>(block.data());
+    std::size_t size = block.size();
+    std::size_t pos = 0;
+    std::uint64_t lines = 0;
+    std::uint64_t words = 0;
+    bool inWord = InWord_;
+    if (Counts_.Bytes == 0) {
+        StartsInWord_ = CountWords_ && !IsSpace(data[0]);
+    }
+
+    if (!CountWords_) {
+#ifdef CLI_WC_COUNTER_X86
+        lines += CountNewlines(data, size, pos);
+#endif
+        for (; pos != size; pos++) {
+            lines += data[pos] == '\n';
+        }
+    }
+
+#ifdef CLI_WC_COUNTER_X86
+    for (; pos + 64 <= size; pos += 64) {
+        std::uint64_t newlines;
+        std::uint64_t spaces;
+        Masks64(data + pos, newlines, spaces);
+        // A word starts at a non-space byte preceded by a space, or by the end of the previous word if not in one.
+        std::uint64_t before = (spaces << 1) | (inWord ? 0 : 1);
+        lines += __builtin_popcountll(newlines);
+        words += __builtin_popcountll(~spaces & before);
+        inWord = (spaces >> 63) == 0;
+    }
+#endif
+
+    for (; pos != size; pos++) {
+        bool isSpace = IsSpace(data[pos]);
+        lines += data[pos] == '\n';
+        words += !isSpace && !inWord;
+        inWord = !isSpace;
+    }
+
+    Counts_.Lines += lines;
+    Counts_.Words += words;
+    Counts_.Bytes += size;
+    InWord_ = inWord;
+    EndsWithNewline_ = data[size - 1] == '\n';
+}
+
+void TWcCounter::AddBytes(std::uint64_t bytes) {
+    Counts_.Bytes += bytes;
+}
+
+void TWcCounter::Append(const TWcCounter& next) {
+    if (next.Counts_.Bytes == 0) {
+        return;
+    }
+    if (Counts_.Bytes == 0) {
+        StartsInWord_ = next.StartsInWord_;
+    }
+    Counts_.Lines += next.Counts_.Lines;
+    Counts_.Words += next.Counts_.Words - (InWord_ && next.StartsInWord_ ? 1 : 0);
+    Counts_.Bytes += next.Counts_.Bytes;
+    InWord_ = next.InWord_;
+    EndsWithNewline_ = next.EndsWithNewline_;
+}
+
+TWcCounts TWcCounter::Counts() const {
+    TWcCounts ret = Counts_;
+    if (!EndsWithNewline_) {
+        ret.Lines++;
+    }
+    return ret;
+}
+
+} // namespace NPrivate
+} // namespace NCli
@@ -0,0 +1,86 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace NCli {
+namespace NPrivate {
+
+/**
+ * The numbers printed by wc.
+ */
+struct TWcCounts {
+    std::uint64_t Lines = 0;
+    std::uint64_t Words = 0;
+    std::uint64_t Bytes = 0;
+};
+
+/**
+ * Counts the lines, the words and the bytes of an input given block by block, in a single pass and in constant memory.
+ *
+ * The results are the same as std::getline and operator>> into a string give in the classic locale: the last line is
+ * counted even if it has no newline, and the words are separated by the characters std::isspace accepts. The blocks
+ * are scanned 64 bytes at a time with SSE2 where it is available: the newlines are counted with a population count of
+ * a comparison mask, and the words as the non-space bytes preceded by a space. When the words are not needed, the
+ * comparison results for the newlines are simply summed up.
+ */
+class TWcCounter final {
+public:
+    /**
+     * Creates a counter of an empty input. Unless {@arg countWords} is set, the words are not counted, only the lines
+     * and the bytes.
+     */
+    explicit TWcCounter(bool countWords = true);
+
+    /**
+     * Counts the next block of the input.
+     */
+    void Update(std::string_view block);
+
+    /**
+     * Counts the next {@arg bytes} bytes of the input without looking at them, when only the bytes are needed.
+     */
+    void AddBytes(std::uint64_t bytes);
+
+    /**
+     * Counts the input counted by {@arg next} as if it followed the input counted by this counter, so that an input
+     * may be split into parts counted separately: a word spanning the parts is counted once.
+     */
+    void Append(const TWcCounter& next);
+
+    /**
+     * Returns the numbers for the input given so far, as if it ended here.
+     */
+    TWcCounts Counts() const;
+
+    /**
+     * Returns whether {@arg c} separates words.
+     */
+    static bool IsSpace(unsigned char c);
+
+private:
+    bool CountWords_;
+    TWcCounts Counts_;
+    bool StartsInWord_ = false;
+    bool InWord_ = false;
+    bool EndsWithNewline_ = true;
+};
+
+} // namespace NPrivate
+} // namespace NCli
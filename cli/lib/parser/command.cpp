@@ -18,6 +18,9 @@
 
 #include <environment/environment.h>
 
+#include <iterator>
+#include <utility>
+
 namespace NCli {
 
 TCommand::TCommand(std::vector<std::string> cmdline) {
@@ -25,13 +28,17 @@ TCommand::TCommand(std::vector<std::string> cmdline) {
         auto it = cmdline.begin();
         auto assignment = ParseEnvVarAssignment(*it);
         while (it != cmdline.end() && assignment.has_value()) {
-            Assignments_.push_back(assignment.value());
+            Assignments_.push_back(std::move(assignment.value()));
             it++;
             if (it != cmdline.end()) {
                 assignment = ParseEnvVarAssignment(*it);
             }
         }
-        std::copy(it, cmdline.end(), std::back_inserter(Cmdline_));
+        if (it == cmdline.begin()) {
+            Cmdline_ = std::move(cmdline);
+        } else {
+            Cmdline_.assign(std::make_move_iterator(it), std::make_move_iterator(cmdline.end()));
+        }
     }
 }
 
@@ -16,6 +16,8 @@
 
 #include "parse.h"
 
+#include <utility>
+
 namespace NCli {
 namespace {
 
@@ -28,18 +30,22 @@ bool IsPipe(TExtChar c) {
 }
 
 TFullCommand Parse(const std::vector<TToken>& tokens) {
+    return Parse(std::vector<TToken>(tokens));
+}
+
+TFullCommand Parse(std::vector<TToken>&& tokens) {
     std::vector<std::string> nextCommand;
     TFullCommand ret;
-    for (const auto& token: tokens) {
+    for (auto& token: tokens) {
         if (token.Size() == 1 && IsPipe(token[0])) {
-            ret.push_back(TCommand(nextCommand));
+            ret.push_back(TCommand(std::move(nextCommand)));
             nextCommand.clear();
         } else {
-            nextCommand.push_back(token.ToString());
+            nextCommand.push_back(std::move(token).ToString());
         }
     }
     if (!nextCommand.empty()) {
-        ret.push_back(TCommand(nextCommand));
+        ret.push_back(TCommand(std::move(nextCommand)));
     }
     return ret;
 }
@@ -33,4 +33,9 @@ using TFullCommand = std::vector<TCommand>;
  */
 TFullCommand Parse(const std::vector<TToken>& tokens);
 
+/**
+ * The same as the other overload, but the strings are moved out of the tokens where possible.
+ */
+TFullCommand Parse(std::vector<TToken>&& tokens);
+
 } // namespace NCli
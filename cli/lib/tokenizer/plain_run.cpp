@@ -0,0 +1,178 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "plain_run.h"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define CLI_PLAIN_RUN_X86
+#endif
+
+namespace NCli {
+namespace {
+
+using TSpecialTable = std::array<bool, 256>;
+
+constexpr bool IsWhitespace(unsigned char c) {
+    // Exactly the characters for which std::isspace is true in the "C" locale.
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+constexpr TSpecialTable MakeSpecialTable(EPlainRunKind kind) {
+    TSpecialTable table{};
+    for (std::size_t c = 0; c != table.size(); c++) {
+        switch (kind) {
+            case EPlainRunKind::WORD:
+                table[c] = c == '\\' || c == '\'' || c == '"' || c == '|' || IsWhitespace(c);
+                break;
+            case EPlainRunKind::DOUBLE_QUOTED:
+                table[c] = c == '\\' || c == '"';
+                break;
+            case EPlainRunKind::SINGLE_QUOTED:
+                table[c] = c == '\'';
+                break;
+        }
+    }
+    return table;
+}
+
+constexpr TSpecialTable WORD_SPECIALS = MakeSpecialTable(EPlainRunKind::WORD);
+constexpr TSpecialTable DOUBLE_QUOTED_SPECIALS = MakeSpecialTable(EPlainRunKind::DOUBLE_QUOTED);
+constexpr TSpecialTable SINGLE_QUOTED_SPECIALS = MakeSpecialTable(EPlainRunKind::SINGLE_QUOTED);
+
+const TSpecialTable& SpecialTable(EPlainRunKind kind) {
+    switch (kind) {
+        case EPlainRunKind::WORD:
+            return WORD_SPECIALS;
+        case EPlainRunKind::DOUBLE_QUOTED:
+            return DOUBLE_QUOTED_SPECIALS;
+        case EPlainRunKind::SINGLE_QUOTED:
+        default:
+            return SINGLE_QUOTED_SPECIALS;
+    }
+}
+
+std::size_t ScalarPlainRunLength(const char* data, std::size_t size, std::size_t from, EPlainRunKind kind) {
+    const TSpecialTable& specials = SpecialTable(kind);
+    std::size_t i = from;
+    while (i != size && !specials[static_cast<unsigned char>(data[i])]) {
+        i++;
+    }
+    return i;
+}
+
+#ifdef CLI_PLAIN_RUN_X86
+
+__m128i SpecialMask(__m128i bytes, EPlainRunKind kind) {
+    __m128i mask = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'));
+    switch (kind) {
+        case EPlainRunKind::WORD: {
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\'')));
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')));
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('|')));
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')));
+            // '\t' to '\r': the byte minus '\t' is at most 4 as an unsigned number.
+            __m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted));
+            break;
+        }
+        case EPlainRunKind::DOUBLE_QUOTED:
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')));
+            break;
+        case EPlainRunKind::SINGLE_QUOTED:
+            mask = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\''));
+            break;
+    }
+    return mask;
+}
+
+std::size_t Sse2PlainRunLength(const char* data, std::size_t size, EPlainRunKind kind) {
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(SpecialMask(bytes, kind)));
+        if (bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+    return ScalarPlainRunLength(data, size, i, kind);
+}
+
+__attribute__((target("avx2")))
+__m256i SpecialMask(__m256i bytes, EPlainRunKind kind) {
+    __m256i mask = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\'));
+    switch (kind) {
+        case EPlainRunKind::WORD: {
+            mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\'')));
+            mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"')));
+            mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('|')));
+            mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')));
+            __m256i shifted = _mm256_sub_epi8(bytes, _mm256_set1_epi8('\t'));
+            mask = _mm256_or_si256(mask,
+                                   _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted));
+            break;
+        }
+        case EPlainRunKind::DOUBLE_QUOTED:
+            mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"')));
+            break;
+        case EPlainRunKind::SINGLE_QUOTED:
+            mask = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\''));
+            break;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+std::size_t Avx2PlainRunLength(const char* data, std::size_t size, EPlainRunKind kind) {
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(SpecialMask(bytes, kind)));
+        if (bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+    return ScalarPlainRunLength(data, size, i, kind);
+}
+
+#endif // CLI_PLAIN_RUN_X86
+
+using TPlainRunLengthImpl = std::size_t (*)(const char*, std::size_t, EPlainRunKind);
+
+TPlainRunLengthImpl ChooseImpl() {
+#ifdef CLI_PLAIN_RUN_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return &Avx2PlainRunLength;
+    }
+    return &Sse2PlainRunLength;
+#else
+    return [](const char* data, std::size_t size, EPlainRunKind kind) {
+        return ScalarPlainRunLength(data, size, 0, kind);
+    };
+#endif
+}
+
+} // namespace <anonymous>
+
+std::size_t PlainRunLength(const char* data, std::size_t size, EPlainRunKind kind) {
+    static const TPlainRunLengthImpl impl = ChooseImpl();
+    return impl(data, size, kind);
+}
+
+} // namespace NCli
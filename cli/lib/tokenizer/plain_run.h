@@ -0,0 +1,52 @@
+/**
+ * Copyright 2019 Vasily Alferov
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace NCli {
+
+/**
+ * Denotes which bytes end a run of plain characters for {@link NCli::PlainRunLength}.
+ */
+enum class EPlainRunKind {
+    /**
+     * An unquoted word. The run ends at a backslash, a quote, a pipe or a whitespace character.
+     */
+    WORD,
+
+    /**
+     * The content of double quotes. The run ends at a backslash or a double quote.
+     */
+    DOUBLE_QUOTED,
+
+    /**
+     * The content of single quotes. The run ends at a single quote.
+     */
+    SINGLE_QUOTED
+};
+
+/**
+ * Returns the number of leading bytes of [{@arg data}, {@arg data} + {@arg size}) that have no special meaning in the
+ * context {@arg kind}, so they may be appended to the current token as they are.
+ *
+ * The bytes are scanned 32 or 16 at a time with AVX2 or SSE2 when the processor supports them, and one by one
+ * otherwise.
+ */
+std::size_t PlainRunLength(const char* data, std::size_t size, EPlainRunKind kind);
+
+} // namespace NCli
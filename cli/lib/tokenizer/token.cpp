@@ -16,34 +16,167 @@
 
 #include "token.h"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <utility>
+
 namespace NCli {
+namespace {
+
+constexpr std::uint8_t ESCAPED_BIT = 1;
+constexpr std::uint8_t IGNORE_VARIABLES_BITS = 1 << 1;
+constexpr std::uint8_t JUST_IGNORE_BITS = 2 << 1;
+constexpr std::uint8_t IGNORANCE_MASK = 3 << 1;
+
+} // namespace <anonymous>
+
+std::string TToken::ToString() && {
+    if (Flags_.empty()) {
+        return std::move(Bytes_);
+    }
+    return static_cast<const TToken&>(*this).ToString();
+}
+
+std::string TToken::ToString() const & {
+    // Fake delimiters have flags, so a token without flags is just its bytes.
+    if (Flags_.empty()) {
+        return Bytes_;
+    }
 
-std::string TToken::ToString() const {
     std::string ret;
-    ret.reserve(Token_.size());
-    for (std::size_t i = 0; i != Token_.size(); i++) {
-        if (Token_[i].IgnoranceStatus() == ECharIgnoranceStatus::JUST_IGNORE) {
+    ret.reserve(Bytes_.size());
+    for (std::size_t i = 0; i != Bytes_.size(); i++) {
+        if ((FlagsAt(i) & IGNORANCE_MASK) == JUST_IGNORE_BITS) {
             continue;
         }
-        ret.push_back(Token_[i].ToChar());
+        ret.push_back(Bytes_[i]);
     }
     return ret;
 }
 
-TExtChar& TToken::operator[](std::size_t i) {
-    return Token_[i];
+TExtChar TToken::operator[](std::size_t i) const {
+    std::uint8_t flags = FlagsAt(i);
+    ECharIgnoranceStatus ignorance = ECharIgnoranceStatus::NOTHING;
+    if ((flags & IGNORANCE_MASK) == IGNORE_VARIABLES_BITS) {
+        ignorance = ECharIgnoranceStatus::IGNORE_VARIABLES;
+    } else if ((flags & IGNORANCE_MASK) == JUST_IGNORE_BITS) {
+        ignorance = ECharIgnoranceStatus::JUST_IGNORE;
+    }
+    return TExtChar(Bytes_[i],
+                    (flags & ESCAPED_BIT) ? ECharEscapeStatus::ESCAPED : ECharEscapeStatus::UNESCAPED,
+                    ignorance);
+}
+
+std::string_view TToken::Bytes() const {
+    return Bytes_;
 }
 
-const TExtChar& TToken::operator[](std::size_t i) const {
-    return Token_[i];
+bool TToken::IsPlain() const {
+    return Flags_.empty();
 }
 
 void TToken::PushBack(const TExtChar& character) {
-    Token_.push_back(character);
+    char c = character.ToChar();
+    Append(&c, 1, character.EscapeStatus(), character.IgnoranceStatus());
+}
+
+void TToken::Append(const char* data, std::size_t size, ECharEscapeStatus escaped, ECharIgnoranceStatus ignorance) {
+    std::size_t from = Bytes_.size();
+    Bytes_.append(data, size);
+    std::uint8_t flags = Encode(escaped, ignorance);
+    if (flags != 0) {
+        GrowFlags();
+        SetFlags(from, Bytes_.size(), flags);
+    } else if (!Flags_.empty()) {
+        GrowFlags();
+    }
+}
+
+void TToken::Append(const TToken& other, std::size_t from, std::size_t to) {
+    std::size_t offset = Bytes_.size();
+    Bytes_.append(other.Bytes_, from, to - from);
+    if (other.Flags_.empty()) {
+        if (!Flags_.empty()) {
+            GrowFlags();
+        }
+        return;
+    }
+
+    GrowFlags();
+    for (std::size_t i = from; i != to; i++) {
+        std::uint8_t flags = other.FlagsAt(i);
+        if (flags != 0) {
+            SetFlags(offset + i - from, offset + i - from + 1, flags);
+        }
+    }
+}
+
+void TToken::Clear() {
+    Bytes_.clear();
+    Flags_.clear();
 }
 
 std::size_t TToken::Size() const {
-    return Token_.size();
+    return Bytes_.size();
+}
+
+bool TToken::operator==(const TToken& other) const {
+    if (Bytes_ != other.Bytes_) {
+        return false;
+    }
+    if (Flags_.empty() && other.Flags_.empty()) {
+        return true;
+    }
+    // A token may keep a flags array of zeros, so the flags are compared character by character.
+    for (std::size_t i = 0; i != Bytes_.size(); i++) {
+        if (FlagsAt(i) != other.FlagsAt(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TToken::operator!=(const TToken& other) const {
+    return !(*this == other);
+}
+
+std::size_t TToken::Hash() const {
+    // The tokens differing only in flags are rare, so they are left to collide.
+    return std::hash<std::string>()(Bytes_);
+}
+
+std::uint8_t TToken::Encode(ECharEscapeStatus escaped, ECharIgnoranceStatus ignorance) {
+    std::uint8_t flags = escaped == ECharEscapeStatus::ESCAPED ? ESCAPED_BIT : 0;
+    if (ignorance == ECharIgnoranceStatus::IGNORE_VARIABLES) {
+        flags |= IGNORE_VARIABLES_BITS;
+    } else if (ignorance == ECharIgnoranceStatus::JUST_IGNORE) {
+        flags |= JUST_IGNORE_BITS;
+    }
+    return flags;
+}
+
+std::uint8_t TToken::FlagsAt(std::size_t i) const {
+    if (Flags_.empty()) {
+        return 0;
+    }
+    return (Flags_[i / 2] >> (i % 2 * 4)) & 0xF;
+}
+
+void TToken::SetFlags(std::size_t from, std::size_t to, std::uint8_t flags) {
+    // Two characters share a byte: the even one takes the low half, the odd one takes the high half.
+    for (; from != to && from % 2 != 0; from++) {
+        Flags_[from / 2] = (Flags_[from / 2] & 0x0F) | (flags << 4);
+    }
+    std::size_t pairs = (to - from) / 2;
+    std::memset(Flags_.data() + from / 2, flags | (flags << 4), pairs);
+    for (from += pairs * 2; from != to; from++) {
+        Flags_[from / 2] = (Flags_[from / 2] & 0xF0) | flags;
+    }
+}
+
+void TToken::GrowFlags() {
+    Flags_.resize((Bytes_.size() + 1) / 2, 0);
 }
 
-} // namespace NCli
\ No newline at end of file
+} // namespace NCli
@@ -18,13 +18,19 @@
 
 #include <common/ext_char.h>
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace NCli {
 
 /**
  * Represents a sequence of input characters understood by CLI as a single word. Stores a sequence of extended chars.
+ *
+ * The characters are stored as a contiguous byte string, fake delimiters included (as zero bytes). The flags of every
+ * character take four bits in a separate packed array, which is not allocated at all while every character has the
+ * default flags, as in most of the tokens.
  */
 class TToken {
 public:
@@ -48,30 +54,75 @@ public:
      *
      * This takes account of ignorance and escape statuses of stored extended chars.
      */
-    std::string ToString() const;
+    std::string ToString() const &;
+
+    /**
+     * The same as the other overload, but the bytes are moved out of the token when they make up the string as they
+     * are.
+     */
+    std::string ToString() &&;
+
+    /**
+     * Returns the extended char at given position.
+     */
+    TExtChar operator[](std::size_t i) const;
 
     /**
-     * Returns a reference to extended char at given position.
+     * Returns the stored characters, including the zero bytes standing for fake delimiters.
      */
-    TExtChar& operator[](std::size_t i);
+    std::string_view Bytes() const;
 
     /**
-     * Returns a const reference to extended char at given position.
+     * Returns whether every character has the default flags, so the token is just its bytes.
      */
-    const TExtChar& operator[](std::size_t i) const;
+    bool IsPlain() const;
 
     /**
      * Appends a character to the token.
      */
     void PushBack(const TExtChar& character);
 
+    /**
+     * Appends {@arg size} characters starting at {@arg data}, all with the same flags.
+     */
+    void Append(const char* data, std::size_t size,
+                ECharEscapeStatus escaped = ECharEscapeStatus::UNESCAPED,
+                ECharIgnoranceStatus ignorance = ECharIgnoranceStatus::NOTHING);
+
+    /**
+     * Appends the characters [{@arg from}, {@arg to}) of {@arg other} with their flags.
+     */
+    void Append(const TToken& other, std::size_t from, std::size_t to);
+
+    /**
+     * Removes all the characters. The allocated memory is kept for reuse.
+     */
+    void Clear();
+
     /**
      * Returns number of stored extended characters, including fake delimiters.
      */
     std::size_t Size() const;
 
+    /**
+     * Compares the characters together with their flags.
+     */
+    bool operator==(const TToken& other) const;
+    bool operator!=(const TToken& other) const;
+
+    /**
+     * Returns the hash of the token. Equal tokens have equal hashes.
+     */
+    std::size_t Hash() const;
+
 private:
-    std::vector<TExtChar> Token_;
+    static std::uint8_t Encode(ECharEscapeStatus escaped, ECharIgnoranceStatus ignorance);
+    std::uint8_t FlagsAt(std::size_t i) const;
+    void SetFlags(std::size_t from, std::size_t to, std::uint8_t flags);
+    void GrowFlags();
+
+    std::string Bytes_;
+    std::vector<std::uint8_t> Flags_;
 };
 
 } // namespace NCli
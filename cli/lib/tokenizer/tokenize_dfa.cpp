@@ -16,8 +16,9 @@
 
 #include "tokenize_dfa.h"
 
-#include <stdexcept>
 #include <stack>
+#include <stdexcept>
+#include <utility>
 
 namespace NCli {
 namespace {
@@ -78,10 +79,14 @@ public:
         }
     }
 
-    std::vector<TToken> ParsedTokens() const {
+    const std::vector<TToken>& ParsedTokens() const {
         return CurTokens_;
     }
 
+    std::vector<TToken> TakeTokens() {
+        return std::exchange(CurTokens_, {});
+    }
+
     void PushState(TState* to) {
         StateStack_.push(to);
     }
@@ -125,7 +130,7 @@ public:
             throw TInvalidDFAStateException("token");
         }
 
-        CurTokens_.push_back(NextToken_);
+        CurTokens_.push_back(std::move(NextToken_));
         NextToken_ = TToken();
         TokenizerState_ = ETokenizerState::WAITING;
     }
@@ -176,10 +181,14 @@ void TTokenizeDFA::Update(std::string s) {
     }
 }
 
-std::vector<TToken> TTokenizeDFA::ParsedTokens() const {
+const std::vector<TToken>& TTokenizeDFA::ParsedTokens() const {
     return Impl_->ParsedTokens();
 }
 
+std::vector<TToken> TTokenizeDFA::TakeTokens() {
+    return Impl_->TakeTokens();
+}
+
 TTokenizeDFA::TState* TTokenizeDFA::ZeroState() const {
     return Impl_->ZeroState();
 }
@@ -224,7 +224,12 @@ public:
     /**
      * Returns the sequence of currently parsed tokens.
      */
-    std::vector<TToken> ParsedTokens() const;
+    const std::vector<TToken>& ParsedTokens() const;
+
+    /**
+     * Moves the parsed tokens out of the DFA, leaving it with no parsed tokens.
+     */
+    std::vector<TToken> TakeTokens();
 
 private:
     std::unique_ptr<TImpl> Impl_;
@@ -16,149 +16,210 @@
 
 #include "tokenizer.h"
 
-#include <tokenizer/tokenize_dfa.h>
+#include <tokenizer/plain_run.h>
 
+#include <array>
 #include <cctype>
+#include <string_view>
 #include <utility>
 
-
 namespace NCli {
 
+/**
+ * The tokenizer is a stack automation in the sense of {@link NCli::TTokenizeDFA}, but its grammar is fixed, so the
+ * states are plain enumerators dispatched with a switch and the stack is a small array. The stack never grows deeper
+ * than "zero, token, double quote, escape".
+ */
 class TTokenizer::TImpl {
-    using TDFAState = TTokenizeDFA::TState;
-    using TDFACallback = TTokenizeDFA::TExecCallback;
+    enum class EDFAState {
+        ZERO,
+        TOKEN,
+        SINGLE_QUOTE,
+        DOUBLE_QUOTE,
+        ESCAPE,
+        PIPE
+    };
+
+    static constexpr std::size_t MAX_DEPTH = 4;
 
 public:
-    TImpl() {
-        Zero_ = DFA_.ZeroState();
-        Token_ = DFA_.MakeState();
-        SingleQuote_ = DFA_.MakeState();
-        DoubleQuote_ = DFA_.MakeState();
-        Escape_ = DFA_.MakeState();
-        Pipe_ = DFA_.MakeState();
-
-        Zero_->SetCallback(
-                [this](char c, TDFACallback& cb) {
+    TImpl() = default;
+    ~TImpl() = default;
+    TImpl(const TImpl&) = delete;
+    TImpl& operator=(const TImpl&) = delete;
+    TImpl(TImpl&&) noexcept = default;
+    TImpl& operator=(TImpl&&) noexcept = default;
+
+    void Update(std::string_view s) {
+        const char* data = s.data();
+        std::size_t size = s.size();
+        std::size_t i = 0;
+        while (i != size) {
+            // Runs of plain characters are appended at once, the automation only sees the bytes that end them.
+            i += AppendPlainRun(data + i, size - i);
+            if (i != size) {
+                Update(data[i]);
+                i++;
+            }
+        }
+    }
+
+    TTokenizer::EState State() const {
+        if (Depth_ == 1) {
+            return TTokenizer::EState::DONE;
+        } else {
+            return TTokenizer::EState::WAITING;
+        }
+    }
+
+    const std::vector<TToken>& ParsedTokens() const {
+        return Tokens_;
+    }
+
+    std::vector<TToken> TakeTokens() {
+        return std::exchange(Tokens_, {});
+    }
+
+private:
+    void Update(char c) {
+        // Every "delegate" of the generic automation is a jump back to the dispatch with the same character.
+        while (true) {
+            switch (Stack_[Depth_ - 1]) {
+                case EDFAState::ZERO:
                     if (c == '|') {
-                        cb.PushStateAndDelegate(Pipe_);
-                    } else if (!std::isspace(c)) {
-                        cb.StartToken();
-                        cb.PushStateAndDelegate(Token_);
+                        Push(EDFAState::PIPE);
+                        continue;
+                    } else if (!std::isspace(static_cast<unsigned char>(c))) {
+                        Push(EDFAState::TOKEN);
+                        continue;
                     }
-                }
-        );
-        Token_->SetCallback(
-                [this](char c, TDFACallback& cb) {
+                    return;
+
+                case EDFAState::TOKEN:
                     if (c == '\\') {
-                        cb.PushState(Escape_);
+                        Push(EDFAState::ESCAPE);
                     } else if (c == '\'') {
-                        cb.PushCharacter(TExtChar::FakeDelim());
-                        cb.PushState(SingleQuote_);
+                        Token_.PushBack(TExtChar::FakeDelim());
+                        Push(EDFAState::SINGLE_QUOTE);
                     } else if (c == '"') {
-                        cb.PushCharacter(TExtChar::FakeDelim());
-                        cb.PushState(DoubleQuote_);
-                    } else if (std::isspace(c)) {
-                        cb.EndToken();
-                        cb.PopStateAndDelegate();
+                        Token_.PushBack(TExtChar::FakeDelim());
+                        Push(EDFAState::DOUBLE_QUOTE);
+                    } else if (std::isspace(static_cast<unsigned char>(c))) {
+                        EndToken();
+                        Pop();
+                        continue;
                     } else if (c == '|') {
-                        cb.EndToken();
-                        cb.PopState();
-                        cb.PushStateAndDelegate(Pipe_);
+                        EndToken();
+                        Pop();
+                        Push(EDFAState::PIPE);
+                        continue;
                     } else {
-                        cb.PushCharacter(TExtChar(c));
+                        Token_.PushBack(TExtChar(c));
                     }
-                }
-        );
-        SingleQuote_->SetCallback(
-                [this](char c, TDFACallback& cb) {
+                    return;
+
+                case EDFAState::SINGLE_QUOTE:
                     if (c == '\'') {
-                        cb.PushCharacter(TExtChar::FakeDelim());
-                        cb.PopState();
+                        Token_.PushBack(TExtChar::FakeDelim());
+                        Pop();
                     } else {
-                        cb.PushCharacter(TExtChar(c,
-                                                  ECharEscapeStatus::ESCAPED,
-                                                  ECharIgnoranceStatus::IGNORE_VARIABLES));
+                        Token_.PushBack(TExtChar(c, ECharEscapeStatus::ESCAPED, ECharIgnoranceStatus::IGNORE_VARIABLES));
                     }
-                }
-        );
-        DoubleQuote_->SetCallback(
-                [this](char c, TDFACallback& cb) {
+                    return;
+
+                case EDFAState::DOUBLE_QUOTE:
                     if (c == '\\') {
-                        cb.PushState(Escape_);
+                        Push(EDFAState::ESCAPE);
                     } else if (c == '"') {
-                        cb.PushCharacter(TExtChar::FakeDelim());
-                        cb.PopState();
+                        Token_.PushBack(TExtChar::FakeDelim());
+                        Pop();
                     } else {
-                        cb.PushCharacter(TExtChar(c));
+                        Token_.PushBack(TExtChar(c));
                     }
-                }
-        );
-        Escape_->SetCallback(
-                [this](char c, TDFACallback& cb) {
+                    return;
+
+                case EDFAState::ESCAPE:
                     if (c != '\n') {
-                        cb.PushCharacter(TExtChar(c, ECharEscapeStatus::ESCAPED));
+                        Token_.PushBack(TExtChar(c, ECharEscapeStatus::ESCAPED));
                     }
-                    cb.PopState();
-                }
-        );
-        Pipe_->SetCallback(
-                [this](char c, TDFACallback& cb) {
-                    cb.StartToken();
-                    cb.PushCharacter(TExtChar(c));
-                    cb.EndToken();
-                    cb.PopState();
-                }
-        );
+                    Pop();
+                    return;
+
+                case EDFAState::PIPE:
+                    Token_.PushBack(TExtChar(c));
+                    EndToken();
+                    Pop();
+                    return;
+            }
+        }
     }
 
-    ~TImpl() = default;
-    TImpl(const TImpl&) = delete;
-    TImpl& operator=(const TImpl&) = delete;
-    TImpl(TImpl&&) noexcept = default;
-    TImpl& operator=(TImpl&&) noexcept = default;
+    std::size_t AppendPlainRun(const char* data, std::size_t size) {
+        std::size_t length;
+        switch (Stack_[Depth_ - 1]) {
+            case EDFAState::TOKEN:
+                length = PlainRunLength(data, size, EPlainRunKind::WORD);
+                Token_.Append(data, length);
+                return length;
+            case EDFAState::DOUBLE_QUOTE:
+                length = PlainRunLength(data, size, EPlainRunKind::DOUBLE_QUOTED);
+                Token_.Append(data, length);
+                return length;
+            case EDFAState::SINGLE_QUOTE:
+                length = PlainRunLength(data, size, EPlainRunKind::SINGLE_QUOTED);
+                Token_.Append(data, length, ECharEscapeStatus::ESCAPED, ECharIgnoranceStatus::IGNORE_VARIABLES);
+                return length;
+            default:
+                return 0;
+        }
+    }
 
-    void Update(std::string s) {
-        DFA_.Update(std::move(s));
+    void Push(EDFAState state) {
+        Stack_[Depth_++] = state;
     }
 
-    TTokenizer::EState State() const {
-        if (DFA_.CurrentState() == Zero_) {
-            return TTokenizer::EState::DONE;
-        } else {
-            return TTokenizer::EState::WAITING;
-        }
+    void Pop() {
+        Depth_--;
     }
 
-    std::vector<TToken> ParsedTokens() const {
-        return DFA_.ParsedTokens();
+    void EndToken() {
+        // The copy is allocated at its exact size at once, while the buffer being filled keeps its capacity.
+        Tokens_.push_back(Token_);
+        Token_.Clear();
     }
 
 private:
-    TTokenizeDFA DFA_;
-    TDFAState* Zero_;
-    TDFAState* Token_;
-    TDFAState* SingleQuote_;
-    TDFAState* DoubleQuote_;
-    TDFAState* Escape_;
-    TDFAState* Pipe_;
+    std::array<EDFAState, MAX_DEPTH> Stack_{EDFAState::ZERO};
+    std::size_t Depth_ = 1;
+
+    TToken Token_;
+    std::vector<TToken> Tokens_;
 };
 
 TTokenizer::TTokenizer()
     : Impl_(std::make_unique<TImpl>())
 {}
 
-void TTokenizer::Update(std::string s) {
-    Impl_->Update(std::move(s));
+void TTokenizer::Update(std::string_view s) {
+    Impl_->Update(s);
 }
 
 TTokenizer::EState TTokenizer::State() const {
     return Impl_->State();
 }
 
-std::vector<TToken> TTokenizer::ParsedTokens() const {
+const std::vector<TToken>& TTokenizer::ParsedTokens() const {
     return Impl_->ParsedTokens();
 }
 
+std::vector<TToken> TTokenizer::TakeTokens() {
+    return Impl_->TakeTokens();
+}
+
 TTokenizer::~TTokenizer() = default;
 
+TTokenizer::TTokenizer(TTokenizer&&) noexcept = default;
+
+TTokenizer& TTokenizer::operator=(TTokenizer&&) noexcept = default;
+
 } // namespace NCli
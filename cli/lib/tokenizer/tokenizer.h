@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace NCli {
@@ -44,17 +45,17 @@ public:
     ~TTokenizer();
 
     /**
-     * Those restrictions are dictated by the {@link NCli::TTokenizeDFA}, which is stored inside.
+     * The tokenizer is not copy-constructible nor copy-assignable, but move-constructible and move-assignable.
      */
     TTokenizer(const TTokenizer&) = delete;
     TTokenizer& operator=(const TTokenizer&) = delete;
-    TTokenizer(TTokenizer&&) noexcept = default;
-    TTokenizer& operator=(TTokenizer&&) noexcept = default;
+    TTokenizer(TTokenizer&&) noexcept;
+    TTokenizer& operator=(TTokenizer&&) noexcept;
 
     /**
      * Updates the tokenizer state with a sequence of input symbols.
      */
-    void Update(std::string s);
+    void Update(std::string_view s);
 
     /**
      * Returns the tokenizer state.
@@ -67,10 +68,14 @@ public:
 
     /**
      * Returns a sequence of parsed tokens.
-     *
-     * @see NCli::TTokenizeDFA::ParsedTokens
      */
-    std::vector<TToken> ParsedTokens() const;
+    const std::vector<TToken>& ParsedTokens() const;
+
+    /**
+     * Moves the parsed tokens out of the tokenizer, leaving it with no parsed tokens. This is the way to pass the
+     * tokens on without copying them.
+     */
+    std::vector<TToken> TakeTokens();
 
 private:
     class TImpl;
@@ -15,12 +15,58 @@
  */
 
 #include <cli.h>
+#include <common/fd_stream.h>
 #include <common/istream_wrapper.h>
 
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <string_view>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Runs a script given by the command line arguments: "-c script" or a path to a script file.
+ */
+int RunBatch(int argc, char* argv[], char* envp[]) {
+    NCli::TStdinIStreamWrapper in(std::cin);
+    // The output of the whole script is fully buffered, it is written in blocks and at exit.
+    NCli::TFdOStream out(STDOUT_FILENO);
+
+    if (std::string_view(argv[1]) == "-c") {
+        if (argc < 3) {
+            std::cerr << "cli: -c: option requires an argument" << std::endl;
+            return 2;
+        }
+        NCli::RunScript(std::string_view(argv[2]), in, out, std::cerr, envp);
+        return 0;
+    }
+
+    int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        std::cerr << "cli: " << argv[1] << ": " << std::strerror(errno) << std::endl;
+        return 127;
+    }
+    bool read = NCli::RunScript(fd, in, out, std::cerr, envp);
+    close(fd);
+    return read ? 0 : 1;
+}
+
+} // namespace <anonymous>
 
 int main(int argc, char* argv[], char* envp[]) {
+    // Without the synchronization with stdio, std::cin has its own buffer and tells how much of the input it holds,
+    // so the built-ins reading the shell stdin take that first and then read the descriptor in blocks.
+    std::ios::sync_with_stdio(false);
+    if (argc > 1) {
+        return RunBatch(argc, argv, envp);
+    }
     NCli::TStdinIStreamWrapper in(std::cin);
-    NCli::RunMain(in, std::cout, std::cerr, envp);
+    // The output of the built-ins and the commands is buffered, but a terminal still sees it line by line.
+    NCli::TFdOStream out(STDOUT_FILENO, isatty(STDOUT_FILENO) ? NCli::EFlushPolicy::LINE : NCli::EFlushPolicy::FULL);
+    NCli::RunMain(in, out, std::cerr, envp);
     return 0;
 }
@@ -18,12 +18,27 @@
 
 #include <environment/environment.h>
 
+#include <set>
+#include <string>
+
 using namespace NCli;
 
+namespace {
+
+std::multiset<std::string> Collect(char* const* envp) {
+    std::multiset<std::string> ret;
+    for (; *envp != nullptr; envp++) {
+        ret.insert(*envp);
+    }
+    return ret;
+}
+
+} // namespace <anonymous>
+
 TEST(EnvironmentTest, LoadEmptyGlobalEnvironment) {
     const char* envp[] = {nullptr};
     auto env = LoadGlobalEnvironment(envp);
-    ASSERT_TRUE(env.empty());
+    ASSERT_TRUE(env.Empty());
 }
 
 TEST(EnvironmentTest, LoadGlobalEnvironment) {
@@ -73,3 +88,84 @@ TEST(EnvironmentTest, GetUnexistentValue) {
     TCmdEnvironment environment(env);
     ASSERT_EQ("", environment.GetValue(""));
 }
+
+TEST(EnvironmentTest, EnvPFollowsAssignments) {
+    TEnvironment env;
+    env["A"] = "1";
+    env["B"] = "2";
+    ASSERT_EQ(std::multiset<std::string>({"A=1", "B=2"}), Collect(env.EnvP()));
+
+    env["A"] = "a much longer value which does not fit in a small string";
+    env["C"] = "3";
+    ASSERT_EQ(std::multiset<std::string>({"A=a much longer value which does not fit in a small string", "B=2", "C=3"}),
+              Collect(env.EnvP()));
+
+    TEnvironment copy = env;
+    env["B"] = "changed";
+    ASSERT_EQ(std::multiset<std::string>({"A=a much longer value which does not fit in a small string", "B=2", "C=3"}),
+              Collect(copy.EnvP()));
+}
+
+TEST(EnvironmentTest, CmdEnvPOverlay) {
+    TEnvironment env;
+    env["PATH"] = "/bin";
+    env["HOME"] = "/home";
+
+    {
+        TCmdEnvironment cmdEnv(env);
+        cmdEnv.SetLocalValue("PATH", "/usr/bin");
+        cmdEnv.SetLocalValue("NEW", "value");
+        auto envp = cmdEnv.EnvP();
+        ASSERT_EQ(std::multiset<std::string>({"PATH=/usr/bin", "HOME=/home", "NEW=value"}), Collect(envp.Get()));
+    }
+
+    ASSERT_EQ(std::multiset<std::string>({"PATH=/bin", "HOME=/home"}), Collect(env.EnvP()));
+}
+
+TEST(EnvironmentTest, ManyVariables) {
+    TEnvironment env;
+    for (int i = 0; i != 1000; i++) {
+        env["VAR_" + std::to_string(i)] = std::to_string(i * i);
+    }
+    ASSERT_EQ(1000u, env.Size());
+    for (int i = 0; i != 1000; i++) {
+        const std::string* value = env.Find("VAR_" + std::to_string(i));
+        ASSERT_NE(nullptr, value);
+        ASSERT_EQ(std::to_string(i * i), *value);
+    }
+    ASSERT_EQ(nullptr, env.Find("VAR_1000"));
+    ASSERT_EQ("", env.GetValue("VAR_"));
+    ASSERT_EQ(1000u, env.Size());
+
+    TEnvironment copy = env;
+    ASSERT_EQ(env, copy);
+    copy["VAR_5"] = "changed";
+    ASSERT_NE(env, copy);
+}
+
+TEST(EnvironmentTest, SnapshotsAreIndependent) {
+    TEnvironment env;
+    env["A"] = "1";
+    env["B"] = "2";
+    ASSERT_EQ(std::multiset<std::string>({"A=1", "B=2"}), Collect(env.EnvP()));
+
+    TEnvironment snapshot = env;
+    TEnvironment other = snapshot;
+    snapshot["A"] = "snapshot";
+    snapshot["C"] = "3";
+    env["B"] = "global";
+
+    ASSERT_EQ("1", env.GetValue("A"));
+    ASSERT_EQ(nullptr, env.Find("C"));
+    ASSERT_EQ(std::multiset<std::string>({"A=1", "B=global"}), Collect(env.EnvP()));
+    ASSERT_EQ(std::multiset<std::string>({"A=snapshot", "B=2", "C=3"}), Collect(snapshot.EnvP()));
+    ASSERT_EQ(std::multiset<std::string>({"A=1", "B=2"}), Collect(other.EnvP()));
+
+    TCmdEnvironment cmdEnv(snapshot);
+    cmdEnv.SetLocalValue("C", "local");
+    cmdEnv.SetLocalValue("D", "4");
+    ASSERT_EQ("snapshot", cmdEnv.GetValue("A"));
+    ASSERT_EQ("local", cmdEnv.GetValue("C"));
+    ASSERT_EQ("4", cmdEnv.GetValue("D"));
+    ASSERT_EQ("", cmdEnv.GetValue("E"));
+}
@@ -93,4 +93,58 @@ TEST(ExampleTest, ExitInSubsequentVars) {
 
     ASSERT_TRUE(err.str().empty());
     ASSERT_EQ(expectedOutput, os.str());
-}
\ No newline at end of file
+}
+
+TEST(ExampleTest, ScriptHasNoPrompts) {
+    std::string script = "x=ex\n"
+                         "echo \"first\n"
+                         "second\" | wc\n"
+                         "echo $x\n"
+                         "no-such-command-anywhere\n"
+                         "$x\"it\"\n"
+                         "echo unreachable\n";
+
+    std::istringstream is;
+    NCli::TStdinIStreamWrapper isw(is);
+    std::ostringstream os;
+    std::ostringstream err;
+    char* envp[] = {nullptr};
+
+    NCli::RunScript(script, isw, os, err, envp);
+
+    ASSERT_EQ("\t2\t2\t13\nex\n", os.str());
+    ASSERT_FALSE(err.str().empty());
+}
+
+TEST(ExampleTest, ScriptIsReadInBlocks) {
+    // The script is longer than a block, so some lines span two blocks.
+    std::string script;
+    std::string expectedOutput;
+    for (int i = 0; i != 20000; i++) {
+        script += "echo line " + std::to_string(i) + "\n";
+        expectedOutput += "line " + std::to_string(i) + "\n";
+    }
+    script += "echo last line without a newline";
+    expectedOutput += "last line without a newline\n";
+
+    std::string filename = "tempXXXXXX";
+    int fd = mkstemp(const_cast<char*>(filename.c_str()));
+    {
+        std::ofstream out(filename);
+        out << script;
+    }
+
+    std::istringstream is;
+    NCli::TStdinIStreamWrapper isw(is);
+    std::ostringstream os;
+    std::ostringstream err;
+    char* envp[] = {nullptr};
+
+    ASSERT_TRUE(NCli::RunScript(fd, isw, os, err, envp));
+
+    ASSERT_TRUE(err.str().empty());
+    ASSERT_EQ(expectedOutput, os.str());
+
+    close(fd);
+    std::filesystem::remove(std::filesystem::path(filename));
+}
@@ -16,17 +16,25 @@
 
 #include <gtest/gtest.h>
 
+#include <common/exit_exception.h>
+#include <common/fd_stream.h>
+#include <common/pipe.h>
 #include <executor/execute.h>
 #include <parser/parse.h>
 #include <tokenizer/tokenizer.h>
 
+#include <csignal>
 #include <sstream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 using namespace NCli;
 
 namespace {
 
-void DoTest(std::string command, std::string in, std::string expectedOut) {
+void DoTest(std::string command, std::string in, std::string expectedOut, std::string spawnMethod = "",
+            std::string pipeSize = "") {
     TTokenizer tokenizer;
     tokenizer.Update(command);
     ASSERT_EQ(TTokenizer::EState::DONE, tokenizer.State());
@@ -38,6 +46,12 @@ void DoTest(std::string command, std::string in, std::string expectedOut) {
 
     TEnvironment env;
     env["PATH"] = getenv("PATH");
+    if (!spawnMethod.empty()) {
+        env["CLI_SPAWN_METHOD"] = spawnMethod;
+    }
+    if (!pipeSize.empty()) {
+        env["CLI_PIPE_SIZE"] = pipeSize;
+    }
     Execute(cmd, env, inputWrapper, output);
 
     ASSERT_EQ(expectedOut, output.str());
@@ -59,4 +73,146 @@ TEST(ExecuteTest, DestroyedStdout) {
 
 TEST(ExecuteTest, OneAssignment) {
     DoTest("FILE=example.txt\n", "", "");
-}
\ No newline at end of file
+}
+
+TEST(ExecuteTest, EchoIntoPipeline) {
+    DoTest("echo abc | cat - | wc\n", "UNEXPECTED", "\t1\t1\t4\n");
+}
+
+TEST(ExecuteTest, LargeInputThroughPipeline) {
+    std::string input;
+    for (int i = 0; i != 100000; i++) {
+        input += "line number " + std::to_string(i) + "\n";
+    }
+    DoTest("cat - | cat - | cat -\n", input, input);
+}
+
+TEST(ExecuteTest, ExitInPipeline) {
+    TTokenizer tokenizer;
+    tokenizer.Update("cat - | exit\n");
+    TFullCommand cmd = Parse(tokenizer.ParsedTokens());
+
+    std::istringstream input("ignored");
+    TPipeIStreamWrapper inputWrapper(input);
+    std::ostringstream output;
+
+    TEnvironment env;
+    ASSERT_THROW(Execute(cmd, env, inputWrapper, output), TExitException);
+}
+
+TEST(ExecuteTest, LargeInputIgnoredByFirstStage) {
+    std::string input(1 << 22, 'x');
+    DoTest("true | cat -\n", input, "");
+}
+
+TEST(ExecuteTest, BuiltinsAndExternalsInPipeline) {
+    DoTest("cat - | tr a b | grep b | wc\n", "a\nc\na c\n", "\t2\t3\t6\n");
+}
+
+TEST(ExecuteTest, ExternalsWithForkSpawnMethod) {
+    DoTest("cat - | tr a b | tr c d\n", "abc\n", "bbd\n", "fork");
+    DoTest("tr a b\n", "abc\n", "bbc\n", "fork");
+}
+
+TEST(ExecuteTest, MissingCommandInPipeline) {
+    TTokenizer tokenizer;
+    tokenizer.Update("tr a b | no-such-command-anywhere\n");
+    TFullCommand cmd = Parse(tokenizer.ParsedTokens());
+
+    std::istringstream input("abc");
+    TPipeIStreamWrapper inputWrapper(input);
+    std::ostringstream output;
+
+    TEnvironment env;
+    env["PATH"] = getenv("PATH");
+    ASSERT_THROW(Execute(cmd, env, inputWrapper, output), std::exception);
+}
+
+TEST(ExecuteTest, FdOStreamFlushPolicy) {
+    int fds[2];
+    ASSERT_EQ(0, pipe2(fds, O_NONBLOCK));
+    char buf[64];
+
+    {
+        TFdOStream full(fds[1]);
+        full << "first line\n" << "second line\n";
+        ASSERT_EQ(-1, read(fds[0], buf, sizeof(buf)));
+        full.flush();
+        ASSERT_EQ(23, read(fds[0], buf, sizeof(buf)));
+    }
+
+    {
+        TFdOStream line(fds[1], EFlushPolicy::LINE);
+        line << "no newline";
+        ASSERT_EQ(-1, read(fds[0], buf, sizeof(buf)));
+        line << '\n';
+        ASSERT_EQ(11, read(fds[0], buf, sizeof(buf)));
+        line << "at exit";
+    }
+    ASSERT_EQ(7, read(fds[0], buf, sizeof(buf)));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(ExecuteTest, PipeCapacity) {
+    TPipe pipe;
+    ASSERT_EQ(FD_CLOEXEC, fcntl(pipe.ReadEndDescriptor(), F_GETFD) & FD_CLOEXEC);
+    ASSERT_EQ(FD_CLOEXEC, fcntl(pipe.WriteEndDescriptor(), F_GETFD) & FD_CLOEXEC);
+    ASSERT_EQ(std::size_t(1) << 16, pipe.Capacity());
+
+    ASSERT_EQ(pipe.Capacity(), pipe.SetCapacity(1 << 10));
+    std::size_t capacity = pipe.SetCapacity(1 << 18);
+    ASSERT_EQ(capacity, pipe.Capacity());
+    ASSERT_EQ(std::min<std::size_t>(1 << 18, TPipe::MaxCapacity()), capacity);
+    ASSERT_EQ(capacity, TPipe::CapacityOf(pipe.WriteEndDescriptor()));
+    ASSERT_EQ(TPipe::MaxCapacity(), pipe.SetCapacity(TPipe::MaxCapacity() * 4));
+
+    pipe.RegisterDirection(TPipe::EDirection::IN);
+    ASSERT_EQ(TPipe::MaxCapacity(), pipe.Capacity());
+    pipe.CloseReadEnd();
+    ASSERT_THROW(pipe.Capacity(), std::logic_error);
+
+    int devNull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    ASSERT_EQ(0u, TPipe::CapacityOf(devNull));
+    close(devNull);
+}
+
+TEST(ExecuteTest, PipeSizeOfPipeline) {
+    std::string input;
+    for (int i = 0; i != 100000; i++) {
+        input += "line number " + std::to_string(i) + "\n";
+    }
+    for (std::string size : {"4096", "1048576", "not a number"}) {
+        DoTest("cat - | tr a X | cat - | tr X a\n", input, input, "", size);
+        DoTest("cat - | tr a X | cat - | tr X a\n", input, input, "fork", size);
+    }
+}
+
+TEST(ExecuteTest, ReadChunkReturnsAvailableInput) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    TFdIStream in(fds[0]);
+    TPipeIStreamWrapper wrapper(in);
+    char buf[1 << 16];
+
+    // The writer is still there, so waiting for the whole buffer would block.
+    ASSERT_EQ(3, write(fds[1], "abc", 3));
+    ASSERT_EQ(3u, wrapper.ReadChunk(buf, sizeof(buf)));
+    ASSERT_EQ("abc", std::string(buf, 3));
+
+    ASSERT_EQ(5, write(fds[1], "defgh", 5));
+    close(fds[1]);
+    ASSERT_EQ(2u, wrapper.ReadChunk(buf, 2));
+    ASSERT_EQ(3u, wrapper.ReadChunk(buf, sizeof(buf)));
+    ASSERT_EQ("fgh", std::string(buf, 3));
+    ASSERT_EQ(0u, wrapper.ReadChunk(buf, sizeof(buf)));
+    close(fds[0]);
+}
+
+TEST(ExecuteTest, BrokenPipeSignalIsRestored) {
+    ASSERT_EQ(SIG_DFL, std::signal(SIGPIPE, SIG_DFL));
+    DoTest("echo abc | cat -\n", "", "abc\n");
+    DoTest("cat -\n", "abc\n", "abc\n", "fork");
+    ASSERT_EQ(SIG_DFL, std::signal(SIGPIPE, SIG_DFL));
+}
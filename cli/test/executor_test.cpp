@@ -17,14 +17,27 @@
 #include <gtest/gtest.h>
 
 #include <common/exit_exception.h>
+#include <common/fd_stream.h>
 #include <executor/executor.h>
+#include <executor/private/builtin_executors.h>
+#include <executor/private/grep_matcher.h>
+#include <executor/private/wc_counter.h>
 #include <parser/parse.h>
 #include <tokenizer/tokenizer.h>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <regex>
 #include <sstream>
+#include <thread>
+#include <vector>
 
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 using namespace NCli;
@@ -74,6 +87,27 @@ TEST(ExecutorTest, CatMinusAsExternalCommand) {
     ASSERT_EQ("Hey there!\n", os.str());
 }
 
+TEST(ExecutorTest, LargeCatMinusAsExternalCommand) {
+    TEnvironment env;
+    env["PATH"] = getenv("PATH");
+    TExecutorPtr executor = TExecutorFactory::MakeExecutor("notbuiltin", env);
+
+    std::string input;
+    for (int i = 0; i != 200000; i++) {
+        input += "line number " + std::to_string(i) + "\n";
+    }
+    std::istringstream is(input);
+    std::ostringstream os;
+
+    TCommand cmd({});
+    MakeCommand("cat -\n", cmd);
+
+    TPipeIStreamWrapper isw(is);
+    executor->Execute(cmd, isw, os);
+
+    ASSERT_EQ(input, os.str());
+}
+
 TEST(ExecutorTest, OneAssignment) {
     TEnvironment env;
     TExecutorPtr executor = TExecutorFactory::MakeExecutor("", env);
@@ -276,6 +310,87 @@ TEST(ExecutorTest, CatFile) {
     ASSERT_EQ(INPUT, os.str());
 }
 
+TEST(ExecutorTest, CatManyFilesToDescriptors) {
+    TTempFile first, second, output;
+    std::string content;
+    for (int i = 0; i != 50000; i++) {
+        content += "line " + std::to_string(i) + "\n";
+    }
+    std::ofstream(first.Filename()) << content;
+    std::ofstream(second.Filename()) << "second";
+    const std::string expected = "before\n" + content + "from stdin\n" + "second";
+
+    TEnvironment env;
+    env["PWD"] = getenv("PWD");
+    NPrivate::TCatExecutor executor(env);
+    TCmdEnvironment cmdEnv(env);
+    TCommand cmd({});
+    MakeCommand("cat " + first.Filename() + " - no-such-file-anywhere " + second.Filename() + "\n", cmd);
+
+    auto run = [&](std::istream& in, std::ostream& out) {
+        out << "before\n";
+        testing::internal::CaptureStderr();
+        int exitCode = executor.Run(cmd, cmdEnv, in, out);
+        ASSERT_EQ("cat: no-such-file-anywhere: No such file or directory\n", testing::internal::GetCapturedStderr());
+        ASSERT_EQ(1, exitCode);
+        out.flush();
+    };
+
+    {
+        // Through the buffers.
+        std::istringstream in("from stdin\n");
+        std::ostringstream out;
+        run(in, out);
+        ASSERT_EQ(expected, out.str());
+    }
+
+    {
+        // Into a regular file, from a pipe with some of the data already read into the input buffer.
+        int fds[2];
+        ASSERT_EQ(0, pipe(fds));
+        ASSERT_TRUE(WriteAll(fds[1], "from stdin\n", 11));
+        close(fds[1]);
+        TFdIStream in(fds[0]);
+        ASSERT_EQ('f', in.peek());
+
+        int fd = open(output.Filename().c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        {
+            TFdOStream out(fd);
+            run(in, out);
+        }
+        close(fd);
+        close(fds[0]);
+        std::ifstream result(output.Filename());
+        ASSERT_EQ(expected, std::string(std::istreambuf_iterator<char>(result), std::istreambuf_iterator<char>()));
+    }
+
+    {
+        // Into a pipe.
+        int in[2], out[2];
+        ASSERT_EQ(0, pipe(in));
+        ASSERT_EQ(0, pipe(out));
+        ASSERT_TRUE(WriteAll(in[1], "from stdin\n", 11));
+        close(in[1]);
+        std::string result;
+        std::thread reader([&]() {
+            char buffer[4096];
+            for (ssize_t got; (got = ReadSome(out[0], buffer, sizeof(buffer))) > 0;) {
+                result.append(buffer, got);
+            }
+        });
+        {
+            TFdIStream input(in[0]);
+            TFdOStream output(out[1]);
+            run(input, output);
+        }
+        close(out[1]);
+        reader.join();
+        close(out[0]);
+        close(in[0]);
+        ASSERT_EQ(expected, result);
+    }
+}
+
 TEST(ExecutorTest, Pwd) {
     TEnvironment env;
     env["PWD"] = "/some/path";
@@ -309,6 +424,156 @@ TEST(ExecutorTest, Wc) {
     ASSERT_EQ("\t3\t3\t21\n", os.str());
 }
 
+TEST(ExecutorTest, WcCounterAgreesWithStreams) {
+    using NPrivate::TWcCounter;
+
+    unsigned state = 54321;
+    auto next = [&state]() {
+        state = state * 1103515245 + 12345;
+        return (state >> 16) & 0x7FFF;
+    };
+    const std::string alphabet = std::string("ab \t\n\v\f\r\x80\xff\x1f!") + '\0';
+
+    for (int test = 0; test != 200; test++) {
+        std::string input;
+        for (std::size_t length = next() % 600; length != 0; length--) {
+            input.push_back(alphabet[next() % alphabet.size()]);
+        }
+
+        long lines = 0;
+        long words = 0;
+        {
+            std::istringstream is(input);
+            for (std::string s; std::getline(is, s);) {
+                lines++;
+            }
+        }
+        {
+            std::istringstream is(input);
+            for (std::string s; is >> s;) {
+                words++;
+            }
+        }
+
+        TWcCounter counter;
+        for (std::size_t pos = 0; pos < input.size();) {
+            std::size_t size = std::min<std::size_t>(next() % 150, input.size() - pos);
+            counter.Update(std::string_view(input).substr(pos, size));
+            pos += size;
+        }
+        ASSERT_EQ(lines, counter.Counts().Lines) << "test " << test;
+        ASSERT_EQ(words, counter.Counts().Words) << "test " << test;
+        ASSERT_EQ(input.size(), counter.Counts().Bytes) << "test " << test;
+
+        TWcCounter joined;
+        TWcCounter linesOnly(false);
+        for (std::size_t pos = 0; pos < input.size();) {
+            std::size_t size = std::min<std::size_t>(next() % 150, input.size() - pos);
+            TWcCounter part;
+            part.Update(std::string_view(input).substr(pos, size));
+            joined.Append(part);
+            linesOnly.Update(std::string_view(input).substr(pos, size));
+            pos += size;
+        }
+        ASSERT_EQ(lines, joined.Counts().Lines) << "test " << test;
+        ASSERT_EQ(words, joined.Counts().Words) << "test " << test;
+        ASSERT_EQ(input.size(), joined.Counts().Bytes) << "test " << test;
+        ASSERT_EQ(lines, linesOnly.Counts().Lines) << "test " << test;
+        ASSERT_EQ(0, linesOnly.Counts().Words) << "test " << test;
+    }
+}
+
+TEST(ExecutorTest, WcFile) {
+    TTempFile temp;
+    {
+        std::ofstream of(temp.Filename());
+        for (int i = 0; i != 100000; i++) {
+            of << "word" << i << " \tother\n";
+        }
+        of << "last line";
+    }
+
+    TEnvironment env;
+    env["PWD"] = getenv("PWD");
+    TExecutorPtr executor = TExecutorFactory::MakeExecutor("wc", env);
+
+    std::istringstream is;
+    TPipeIStreamWrapper isw(is);
+    std::ostringstream os;
+
+    TCommand cmd({});
+    MakeCommand("wc " + temp.Filename() + "\n", cmd);
+
+    executor->Execute(cmd, isw, os);
+    ASSERT_EQ("\t100001\t200002\t" + std::to_string(std::filesystem::file_size(temp.Filename())) + "\n", os.str());
+}
+
+TEST(ExecutorTest, WcManyFiles) {
+    TTempFile small, large;
+    {
+        std::ofstream of(small.Filename());
+        of << "one two\nthree";
+    }
+    {
+        // The large file is counted in chunks, and a word spans the first two of them.
+        std::ofstream of(large.Filename());
+        of << std::string((1 << 25) - 2, '\n') << "word" << std::string(1 << 20, ' ') << "\nlast";
+    }
+    std::string largeSize = std::to_string(std::filesystem::file_size(large.Filename()));
+
+    auto run = [&](std::string cmdLine, int& exitCode) {
+        TEnvironment env;
+        env["PWD"] = getenv("PWD");
+        NPrivate::TWcExecutor executor(env);
+        TCmdEnvironment cmdEnv(env);
+
+        TCommand cmd({});
+        MakeCommand(cmdLine, cmd);
+
+        std::istringstream is("from stdin\n");
+        std::ostringstream os;
+        testing::internal::CaptureStderr();
+        exitCode = executor.Run(cmd, cmdEnv, is, os);
+        return os.str() + testing::internal::GetCapturedStderr();
+    };
+
+    int exitCode = 0;
+    ASSERT_EQ("\t2\t3\t13\t" + small.Filename() + "\n"
+              "\t33554432\t2\t" + largeSize + "\t" + large.Filename() + "\n"
+              "\t1\t2\t11\t-\n"
+              "\t33554435\t7\t" + std::to_string(std::stoul(largeSize) + 24) + "\ttotal\n",
+              run("wc " + small.Filename() + " " + large.Filename() + " -\n", exitCode));
+    ASSERT_EQ(0, exitCode);
+
+    ASSERT_EQ("\t2\t13\t" + small.Filename() + "\n"
+              "\t1\t11\t-\n"
+              "\t3\t24\ttotal\n"
+              "wc: no-such-file-anywhere: No such file or directory\n",
+              run("wc -lc " + small.Filename() + " no-such-file-anywhere -\n", exitCode));
+    ASSERT_EQ(1, exitCode);
+
+    // The standard input is read once, the next "-" finds it at EOF.
+    ASSERT_EQ("\t1\t2\t11\t-\n"
+              "\t0\t0\t0\t-\n"
+              "\t2\t3\t13\t" + small.Filename() + "\n"
+              "\t0\t0\t0\t-\n"
+              "\t3\t5\t24\ttotal\n",
+              run("wc - - " + small.Filename() + " -\n", exitCode));
+    ASSERT_EQ(0, exitCode);
+
+    // A pipe is read to its end by its path even though it cannot seek.
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ(4, write(fds[1], "a b\n", 4));
+    close(fds[1]);
+    ASSERT_EQ("\t1\t2\t4\n", run("wc /dev/fd/" + std::to_string(fds[0]) + "\n", exitCode));
+    ASSERT_EQ(0, exitCode);
+    close(fds[0]);
+
+    ASSERT_EQ("\t" + largeSize + "\n", run("wc -c " + large.Filename() + "\n", exitCode));
+    ASSERT_EQ("\t2\n", run("wc -w " + large.Filename() + "\n", exitCode));
+}
+
 namespace {
 
 std::string DoGrep(std::string cmdLine, std::string input) {
@@ -342,6 +607,71 @@ TEST(ExecutorTest, GrepStdin) {
     ASSERT_EQ(expected, out);
 }
 
+TEST(ExecutorTest, GrepShellStdin) {
+    // The shell stdin is read in blocks from its descriptor, and a long line is searched once it is complete.
+    const std::string longLine(1 << 22, 'x');
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    int savedStdin = dup(STDIN_FILENO);
+    ASSERT_EQ(STDIN_FILENO, dup2(fds[0], STDIN_FILENO));
+    close(fds[0]);
+    std::thread writer([&]() {
+        WriteAll(fds[1], longLine.data(), longLine.size());
+        WriteAll(fds[1], "abc\nxyz\nabc", 11);
+        close(fds[1]);
+    });
+
+    TEnvironment env;
+    NPrivate::TGrepExecutor executor(env);
+    TCmdEnvironment cmdEnv(env);
+    TCommand cmd({});
+    MakeCommand("grep abc\n", cmd);
+    std::ostringstream os;
+    int exitCode = executor.Run(cmd, cmdEnv, std::cin, os);
+    writer.join();
+    dup2(savedStdin, STDIN_FILENO);
+    close(savedStdin);
+
+    ASSERT_EQ(0, exitCode);
+    ASSERT_EQ(longLine + "abc\nabc\n", os.str());
+}
+
+TEST(ExecutorTest, GrepInvalidPattern) {
+    testing::internal::CaptureStderr();
+    std::string out;
+    ASSERT_NO_THROW(out = DoGrep("grep '['\n", "[\n"));
+    ASSERT_EQ("", out);
+    ASSERT_EQ(0u, testing::internal::GetCapturedStderr().find("grep: "));
+}
+
+namespace {
+
+class TThrowingExecutor final : public NPrivate::TInProcessExecutorBase {
+public:
+    using TInProcessExecutorBase::TInProcessExecutorBase;
+
+    int Run(const TCommand&, TCmdEnvironment&, std::istream&, std::ostream&) override {
+        throw std::runtime_error("failure");
+    }
+};
+
+} // namespace <anonymous>
+
+TEST(ExecutorTest, InProcessErrorsAreReported) {
+    TEnvironment env;
+    TThrowingExecutor executor(env);
+    TCommand cmd({});
+    MakeCommand("failing\n", cmd);
+    std::istringstream is;
+    TPipeIStreamWrapper isw(is);
+    std::ostringstream os;
+
+    testing::internal::CaptureStderr();
+    ASSERT_NO_THROW(executor.Execute(cmd, isw, os));
+    ASSERT_NO_THROW(executor.RunStage(cmd, is, os));
+    ASSERT_EQ("failing: failure\nfailing: failure\n", testing::internal::GetCapturedStderr());
+}
+
 TEST(ExecutorTest, GrepIgnoreCase) {
     std::string out = DoGrep("grep -i abc\n",
                              "aBc\n"
@@ -392,6 +722,192 @@ TEST(ExecutorTest, GrepFile) {
     ASSERT_EQ(expected, out);
 }
 
+TEST(ExecutorTest, GrepFilesInParallel) {
+    // A socket exists, but cannot be opened.
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::string socketName = "/tmp/cli_grep_test_" + std::to_string(getpid()) + ".sock";
+    std::strcpy(address.sun_path, socketName.c_str());
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ASSERT_EQ(0, bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+
+    std::vector<TTempFile> temps(8);
+    std::string serialArgs, expected;
+    for (std::size_t i = 0; i != temps.size(); i++) {
+        std::ofstream of(temps[i].Filename());
+        for (std::size_t j = 0; j != 1000 * (i + 1); j++) {
+            of << "file " << i << " line " << j << (j % 7 == 0 ? " abc" : "") << "\n";
+        }
+        serialArgs += " " + temps[i].Filename();
+        if (i == 3) {
+            serialArgs += " no-such-file-anywhere";
+        }
+        if (i == 5) {
+            serialArgs += " " + socketName;
+        }
+        if (i == 6) {
+            // A directory is opened, but cannot be read.
+            serialArgs += " /";
+        }
+    }
+
+    auto run = [&](std::string cmdLine, int& exitCode) {
+        TEnvironment env;
+        env["PWD"] = getenv("PWD");
+        NPrivate::TGrepExecutor executor(env);
+        TCmdEnvironment cmdEnv(env);
+
+        TCommand cmd({});
+        MakeCommand(cmdLine, cmd);
+
+        std::istringstream is;
+        std::ostringstream os;
+        testing::internal::CaptureStderr();
+        exitCode = executor.Run(cmd, cmdEnv, is, os);
+        return os.str() + testing::internal::GetCapturedStderr();
+    };
+
+    int serialCode = 0;
+    std::string serial = run("grep -A 1 abc -j 1" + serialArgs + "\n", serialCode);
+    ASSERT_EQ(2, serialCode);
+    ASSERT_NE(std::string::npos, serial.find("grep: " + socketName + ": No such device or address\n"));
+    ASSERT_NE(std::string::npos, serial.find("grep: /: Is a directory\n"));
+    for (int jobs : {2, 3, 8}) {
+        int parallelCode = 0;
+        ASSERT_EQ(serial, run("grep -A 1 abc -j " + std::to_string(jobs) + serialArgs + "\n", parallelCode));
+        ASSERT_EQ(serialCode, parallelCode);
+    }
+
+    close(sock);
+    unlink(socketName.c_str());
+}
+
+TEST(ExecutorTest, GrepRecursive) {
+    namespace fs = std::filesystem;
+    std::string root = (fs::temp_directory_path() / "grepXXXXXX").string();
+    ASSERT_NE(nullptr, mkdtemp(root.data()));
+
+    std::vector<std::string> expected;
+    for (int i = 0; i != 30; i++) {
+        fs::path dir = fs::path(root) / ("d" + std::to_string(i % 5)) / ("e" + std::to_string(i % 3));
+        fs::create_directories(dir);
+        std::string path = (dir / ("f" + std::to_string(i))).string();
+        std::ofstream(path) << "abc " << i << "\nnothing\nlast abc";
+        expected.push_back(path + ":abc " + std::to_string(i));
+        expected.push_back(path + "-nothing");
+        expected.push_back(path + ":last abc");
+    }
+    std::ofstream(fs::path(root) / "binary") << std::string("abc\0", 4);
+    fs::create_directory_symlink(fs::path(root) / "d0", fs::path(root) / "link");
+    std::sort(expected.begin(), expected.end());
+
+    for (std::string jobs : {"1", "3"}) {
+        std::vector<std::string> lines;
+        std::istringstream out(DoGrep("grep -r -A 1 -j " + jobs + " abc " + root + "\n", ""));
+        for (std::string line; std::getline(out, line);) {
+            lines.push_back(line);
+        }
+        std::sort(lines.begin(), lines.end());
+        ASSERT_EQ(expected, lines);
+    }
+
+    fs::remove_all(root);
+}
+
+TEST(ExecutorTest, GrepLargeInputWithContext) {
+    // The input spans many blocks, has a line longer than a block and no newline at the end.
+    std::vector<std::string> lines;
+    for (int i = 0; i != 100000; i++) {
+        lines.push_back("line " + std::to_string(i) + (i % 97 == 0 || i % 1000 == 1 ? " needle" : ""));
+    }
+    lines[50000] = std::string(600000, 'x') + "needle";
+    lines.back() += " needle";
+
+    std::string input;
+    for (const std::string& line : lines) {
+        input += line + "\n";
+    }
+    input.pop_back();
+
+    for (int context : {0, 1, 3}) {
+        std::string expected;
+        int printLines = -1;
+        for (const std::string& line : lines) {
+            if (line.find("needle") != std::string::npos) {
+                printLines = context;
+            }
+            if (printLines >= 0) {
+                expected += line + "\n";
+                printLines--;
+            }
+        }
+        ASSERT_EQ(expected, DoGrep("grep -A " + std::to_string(context) + " needle\n", input));
+        ASSERT_EQ(expected, DoGrep("grep -A " + std::to_string(context) + " 'n.edle'\n", input));
+        ASSERT_EQ(expected, DoGrep("grep -i -A " + std::to_string(context) + " NeEdLe\n", input));
+    }
+}
+
+TEST(ExecutorTest, GrepMatcherAgreesWithRegex) {
+    using NPrivate::TGrepMatcher;
+
+    const std::vector<std::string> patterns = {
+        "ab", "a", "b_", "Ab", "a b", "a+b", "a{2}", "(a)", "a|b", "]", "ab]", "-",
+        "a.b", "ab*", "a*b", "^ab", "ab$", "a\\.b", "[ab]b", "a[^b]", "\\(ab\\)*b", "a\\{2\\}", "\\(a\\)\\1",
+        ".", "^", "$", "", "b[[:alpha:]]a", "[]a]b", "^ab$", "^a b", "b_$", "^_", "a$", "^a+b$", "^$",
+    };
+    const std::string alphabet = "abAB_ .]-+";
+
+    // A simple deterministic generator, so that the lines are the same in every run.
+    unsigned state = 12345;
+    auto next = [&state]() {
+        state = state * 1103515245 + 12345;
+        return (state >> 16) & 0x7FFF;
+    };
+    std::vector<std::string> lines = {"", "ab", "abab", "ab ab", "xab_", "_ab", "a.b", "aab", "bab"};
+    for (int i = 0; i != 400; i++) {
+        std::string line;
+        for (std::size_t length = next() % 12; length != 0; length--) {
+            line.push_back(alphabet[next() % alphabet.size()]);
+        }
+        lines.push_back(line);
+    }
+
+    for (const std::string& pattern : patterns) {
+        for (bool ignoreCase : {false, true}) {
+            auto style = std::regex_constants::grep;
+            if (ignoreCase) {
+                style |= std::regex_constants::icase;
+            }
+            std::regex regex(pattern, style);
+            for (bool wordRegexp : {false, true}) {
+                TGrepMatcher matcher(pattern, ignoreCase, wordRegexp);
+                NPrivate::TGrepLineRegexp line;
+                NPrivate::TGrepWordRegexp word;
+                for (const std::string& s : lines) {
+                    bool expected = wordRegexp ? word.LineMatches(regex, s) : line.LineMatches(regex, s);
+                    ASSERT_EQ(expected, matcher.LineMatches(s))
+                        << "pattern '" << pattern << "', line '" << s << "', -i " << ignoreCase << ", -w " << wordRegexp;
+                }
+            }
+        }
+    }
+
+    ASSERT_EQ(TGrepMatcher::EKind::LITERAL, TGrepMatcher("a+b", false, false).Kind());
+    ASSERT_EQ(TGrepMatcher::EKind::PREFILTERED, TGrepMatcher("xa*bc.d", false, false).Kind());
+    ASSERT_EQ("bc", TGrepMatcher("xa*bc.d", false, false).Needle());
+    ASSERT_EQ("error: ", TGrepMatcher("^ERROR: [0-9]*$", true, false).Needle());
+    ASSERT_EQ(TGrepMatcher::EKind::REGEX, TGrepMatcher("a*[bc]", false, false).Kind());
+    ASSERT_EQ(TGrepMatcher::EKind::ANCHORED, TGrepMatcher("^ab$", false, false).Kind());
+    ASSERT_EQ(TGrepMatcher::EKind::ANCHORED, TGrepMatcher("ab$", true, true).Kind());
+    ASSERT_EQ(TGrepMatcher::EKind::PREFILTERED, TGrepMatcher("^a\\$", false, false).Kind());
+
+    auto cached = TGrepMatcher::Get("a.b", true, false);
+    ASSERT_EQ(cached, TGrepMatcher::Get("a.b", true, false));
+    ASSERT_NE(cached, TGrepMatcher::Get("a.b", false, false));
+    ASSERT_NE(cached, TGrepMatcher::Get("a.b", true, true));
+    ASSERT_THROW(TGrepMatcher::Get("a\\{", false, false), std::regex_error);
+}
+
 TEST(ExecutorTest, LsWithoutArgs) {
     TTempDir dir;
     TEnvironment env;
@@ -524,3 +1040,83 @@ TEST(ExecutorTest, GrepWordRegexpWithAfterContext) {
     ASSERT_EQ(expected, out);
 }
 
+
+namespace {
+
+std::string RunCommand(const std::string& cmdline, TEnvironment& env) {
+    TCommand cmd({});
+    MakeCommand(cmdline, cmd);
+    TExecutorPtr executor = TExecutorFactory::MakeExecutor(cmd.Command(), env);
+
+    std::istringstream is;
+    TPipeIStreamWrapper isw(is);
+    std::ostringstream os;
+    executor->Execute(cmd, isw, os);
+    return os.str();
+}
+
+} // namespace <anonymous>
+
+TEST(ExecutorTest, HashRemembersExternalCommands) {
+    TEnvironment env;
+    env["PATH"] = getenv("PATH");
+
+    RunCommand("hash -r\n", env);
+    ASSERT_EQ("hash: hash table empty\n", RunCommand("hash\n", env));
+
+    RunCommand("true\n", env);
+    RunCommand("true\n", env);
+    RunCommand("true\n", env);
+    std::string listing = RunCommand("hash\n", env);
+    ASSERT_EQ(0u, listing.find("hits\tcommand\n2\t"));
+    ASSERT_NE(std::string::npos, listing.find("/true\n"));
+
+    RunCommand("hash -r\n", env);
+    ASSERT_EQ("hash: hash table empty\n", RunCommand("hash\n", env));
+
+    RunCommand("hash true no-such-command-anywhere\n", env);
+    listing = RunCommand("hash\n", env);
+    ASSERT_EQ(0u, listing.find("hits\tcommand\n0\t"));
+    ASSERT_EQ(std::string::npos, listing.find("no-such-command-anywhere"));
+}
+
+TEST(ExecutorTest, HashIsDroppedWhenPathChanges) {
+    TEnvironment env;
+    env["PATH"] = getenv("PATH");
+
+    RunCommand("hash -r\n", env);
+    RunCommand("true\n", env);
+    ASSERT_NE("hash: hash table empty\n", RunCommand("hash\n", env));
+
+    // A $PATH assigned for a single command neither uses the table nor drops it.
+    ASSERT_THROW(RunCommand("PATH=/nonexistent true\n", env), TCommandNotFoundException);
+    RunCommand("true\n", env);
+    ASSERT_EQ(0u, RunCommand("hash\n", env).find("hits\tcommand\n1\t"));
+
+    RunCommand("PATH=/nonexistent:" + env["PATH"] + "\n", env);
+    ASSERT_EQ(0u, RunCommand("hash -s\n", env).find("hits\t"));
+    RunCommand("true\n", env);
+    std::string listing = RunCommand("hash\n", env);
+    ASSERT_EQ(0u, listing.find("hits\tcommand\n0\t"));
+
+    env["PATH"] = "/nonexistent";
+    ASSERT_THROW(RunCommand("true\n", env), TCommandNotFoundException);
+}
+
+TEST(ExecutorTest, ExternalCommandInCurrentDirectory) {
+    std::string name = "cli_test_local_command_" + std::to_string(getpid());
+    {
+        std::ofstream of(name);
+        of << "#!/bin/sh\necho local\n";
+    }
+    ASSERT_EQ(0, chmod(name.c_str(), 0755));
+
+    TEnvironment env;
+    env["PATH"] = "/nonexistent";
+    RunCommand("hash -r\n", env);
+    ASSERT_EQ("local\n", RunCommand(name + "\n", env));
+    ASSERT_EQ("local\n", RunCommand("./" + name + "\n", env));
+    ASSERT_EQ("hash: hash table empty\n", RunCommand("hash\n", env));
+
+    unlink(name.c_str());
+}
@@ -16,13 +16,49 @@
 
 #include <gtest/gtest.h>
 
+#include <environment/var_expander.h>
 #include <parser/parse.h>
 #include <tokenizer/tokenizer.h>
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
 using namespace NCli;
 
 namespace {
 
+std::atomic<bool> CountAllocations{false};
+std::atomic<std::size_t> Allocations{0};
+
+} // namespace <anonymous>
+
+/**
+ * The global allocation functions are replaced for the whole test binary to count the allocations made while
+ * {@link CountAllocations} is set.
+ */
+void* operator new(std::size_t size) {
+    if (CountAllocations) {
+        Allocations++;
+    }
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
 bool operator==(const TAssignment& lhs, const TAssignment& rhs) {
     return lhs.Name == rhs.Name && lhs.Value == rhs.Value;
 }
@@ -34,6 +70,36 @@ TFullCommand DoParse(std::string input) {
     return Parse(tokens);
 }
 
+/**
+ * Runs a line through the whole front end the way the main loop does and returns the number of allocations made.
+ */
+std::size_t FrontEndAllocations(const std::string& line) {
+    TEnvironment env;
+    env["VAR"] = "value";
+    TVarExpander expander(env);
+
+    Allocations = 0;
+    CountAllocations = true;
+    TFullCommand command;
+    {
+        TTokenizer tokenizer;
+        tokenizer.Update(line);
+        command = Parse(expander.Expand(tokenizer.TakeTokens()));
+    }
+    CountAllocations = false;
+
+    EXPECT_EQ(2u, command.size());
+    return Allocations;
+}
+
+std::string MakeLine(std::size_t args) {
+    std::string line = "cmd";
+    for (std::size_t i = 0; i != args; i++) {
+        line += " arg" + std::to_string(i) + " $VAR";
+    }
+    return line + " | wc -l\n";
+}
+
 } // namespace <anonymous>
 
 TEST(ParseTest, Empty) {
@@ -53,4 +119,13 @@ TEST(ParseTest, Assignments) {
     ASSERT_EQ(2, result.size());
     ASSERT_EQ(1, result[0].Assignments().size());
     ASSERT_EQ(1, result[1].Assignments().size());
-}
\ No newline at end of file
+}
+
+TEST(ParseTest, NoAllocationsPerToken) {
+    // Short tokens fit in the small buffers of the strings, and every token is moved from the tokenizer to the
+    // command, so only the containers allocate, logarithmically in the number of tokens.
+    std::size_t shortLine = FrontEndAllocations(MakeLine(64));
+    std::size_t longLine = FrontEndAllocations(MakeLine(128));
+    ASSERT_LT(shortLine, 32u);
+    ASSERT_LE(longLine, shortLine + 4);
+}
@@ -105,4 +105,69 @@ TEST(TokenizerTest, Pipelines) {
             {"echo $VAR | cat - |cat -|grep value1|grep value2\n"},
             {"echo", "$VAR", "|", "cat", "-", "|", "cat", "-", "|", "grep", "value1", "|", "grep", "value2"}
     );
-}
\ No newline at end of file
+}
+
+TEST(TokenizerTest, CharacterFlags) {
+    TTokenizer tokenizer;
+    tokenizer.Update("a'b'\"c\"\\d|e\n");
+    ASSERT_EQ(TTokenizer::EState::DONE, tokenizer.State());
+
+    auto tokens = tokenizer.ParsedTokens();
+    ASSERT_EQ(3u, tokens.size());
+    ASSERT_EQ(8u, tokens[0].Size());
+
+    ASSERT_EQ(ECharIgnoranceStatus::JUST_IGNORE, tokens[0][1].IgnoranceStatus());
+    ASSERT_EQ('b', tokens[0][2].ToChar());
+    ASSERT_EQ(ECharEscapeStatus::ESCAPED, tokens[0][2].EscapeStatus());
+    ASSERT_EQ(ECharIgnoranceStatus::IGNORE_VARIABLES, tokens[0][2].IgnoranceStatus());
+    ASSERT_EQ('c', tokens[0][5].ToChar());
+    ASSERT_EQ(ECharEscapeStatus::UNESCAPED, tokens[0][5].EscapeStatus());
+    ASSERT_EQ(ECharIgnoranceStatus::NOTHING, tokens[0][5].IgnoranceStatus());
+    ASSERT_EQ('d', tokens[0][7].ToChar());
+    ASSERT_EQ(ECharEscapeStatus::ESCAPED, tokens[0][7].EscapeStatus());
+
+    ASSERT_EQ("|", tokens[1].ToString());
+    ASSERT_EQ("e", tokens[2].ToString());
+}
+
+TEST(TokenizerTest, LongPlainRuns) {
+    std::string word(100, 'w');
+    std::string quoted(77, 'q');
+    DoTest(
+            {
+                    word + " " + word + "\t" + word + "|" + word + "\n"
+                    "\"" + quoted + "\\\"" + quoted + "\" '" + quoted + "\\" + quoted + "'\n"
+            },
+            {word, word, word, "|", word, quoted + "\"" + quoted, quoted + "\\" + quoted}
+    );
+}
+
+TEST(TokenizerTest, WholeInputAndCharacterByCharacter) {
+    std::string input;
+    const std::string pieces[] = {"word", " ", "\t", "|", "'", "\"", "\\", "$VAR", "\n", "abcdefghijklmnopq"};
+    unsigned state = 12345;
+    for (std::size_t i = 0; i != 5000; i++) {
+        state = state * 1103515245 + 12345;
+        input += pieces[(state >> 16) % (sizeof(pieces) / sizeof(pieces[0]))];
+    }
+    input += "'\"\n";
+
+    TTokenizer whole;
+    whole.Update(input);
+    TTokenizer byCharacter;
+    for (char c : input) {
+        byCharacter.Update(std::string(1, c));
+    }
+
+    auto expected = byCharacter.ParsedTokens();
+    auto actual = whole.ParsedTokens();
+    ASSERT_EQ(expected.size(), actual.size());
+    for (std::size_t i = 0; i != expected.size(); i++) {
+        ASSERT_EQ(expected[i].Size(), actual[i].Size());
+        for (std::size_t j = 0; j != expected[i].Size(); j++) {
+            ASSERT_EQ(expected[i][j].ToChar(), actual[i][j].ToChar());
+            ASSERT_EQ(expected[i][j].EscapeStatus(), actual[i][j].EscapeStatus());
+            ASSERT_EQ(expected[i][j].IgnoranceStatus(), actual[i][j].IgnoranceStatus());
+        }
+    }
+}
@@ -93,4 +93,63 @@ TEST(VarExpanderTest, SubsequentVars) {
         "$x$y\n",
         {"exit"}
     );
-}
\ No newline at end of file
+}
+TEST(VarExpanderTest, EscapedAndQuotedDollars) {
+    DoTest(
+        R"(a\$VAR"b$VAR"'$VAR'$VAR\$x$y.$ $)" "\n",
+        {"a$VARbvalue$VARvalue$xit.", ""}
+    );
+}
+
+TEST(VarExpanderTest, FlagsArePreserved) {
+    auto env = DefaultTestEnv();
+    TVarExpander expander(env);
+
+    TTokenizer tokenizer;
+    tokenizer.Update("'|'$VAR\\|\n");
+    auto tokens = expander.Expand(tokenizer.ParsedTokens());
+
+    ASSERT_EQ(1u, tokens.size());
+    ASSERT_EQ("|value|", tokens[0].ToString());
+    ASSERT_EQ(ECharIgnoranceStatus::JUST_IGNORE, tokens[0][0].IgnoranceStatus());
+    ASSERT_EQ(ECharIgnoranceStatus::IGNORE_VARIABLES, tokens[0][1].IgnoranceStatus());
+    ASSERT_EQ(ECharEscapeStatus::UNESCAPED, tokens[0][3].EscapeStatus());
+    ASSERT_EQ(ECharEscapeStatus::ESCAPED, tokens[0][tokens[0].Size() - 1].EscapeStatus());
+}
+
+TEST(VarExpanderTest, MissingVariablesAreNotCreated) {
+    auto env = DefaultTestEnv();
+    auto size = env.Size();
+    TVarExpander expander(env);
+
+    TTokenizer tokenizer;
+    tokenizer.Update("a$MISSING$VAR$\n");
+    auto tokens = expander.Expand(tokenizer.ParsedTokens());
+
+    ASSERT_EQ("avalue", tokens[0].ToString());
+    ASSERT_EQ(size, env.Size());
+    ASSERT_EQ(nullptr, env.Find("MISSING"));
+}
+
+TEST(VarExpanderTest, RepeatedLinesFollowTheEnvironment) {
+    auto env = DefaultTestEnv();
+    TVarExpander expander(env);
+
+    auto expand = [&](std::string line) {
+        TTokenizer tokenizer;
+        tokenizer.Update(std::move(line));
+        std::vector<std::string> actual;
+        for (auto& token : expander.Expand(tokenizer.TakeTokens())) {
+            actual.push_back(std::move(token).ToString());
+        }
+        return actual;
+    };
+
+    const std::string line = "echo $VAR:$x$y '$VAR' \\$VAR $\n";
+    ASSERT_EQ(std::vector<std::string>({"echo", "value:exit", "$VAR", "$VAR", ""}), expand(line));
+    env["VAR"] = "changed";
+    env["y"] = "";
+    ASSERT_EQ(std::vector<std::string>({"echo", "changed:ex", "$VAR", "$VAR", ""}), expand(line));
+    ASSERT_EQ(std::vector<std::string>({"$VAR:$x$y"}), expand("'$VAR:$x$y'\n"));
+    ASSERT_EQ(std::vector<std::string>({"changed:ex"}), expand("\"$VAR:$x$y\"\n"));
+}